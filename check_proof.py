@@ -67,6 +67,15 @@ def main():
                         print(f"  Step {step_num}: ✗ Error: {step.get('error', 'Unknown')}")
             print()
         
+        # Report theorems whose bodies could not be verified
+        theorem_results = result.get("theorem_results", {})
+        unverified = {name: r for name, r in theorem_results.items() if r.get("status") != "proven"}
+        if unverified:
+            print("Unverified Theorems:")
+            for name, r in unverified.items():
+                print(f"  {name}: ✗ {r.get('status', 'error')}")
+            print()
+        
         if result.get("ok"):
             print("STATUS: PROVEN")
             print("The claim follows logically from the assumptions.")
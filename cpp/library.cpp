@@ -0,0 +1,153 @@
+/*
+ * Proof Checker - Precompiled Theorem Libraries
+ *
+ * Artifacts are memory-mapped read-only; the theorem payload is parsed in
+ * place and source files are re-hashed to detect stale artifacts.
+ */
+
+#include "library.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char ARTIFACT_MAGIC[8] = {'P', 'R', 'O', 'O', 'F', 'L', 'I', 'B'};
+constexpr uint32_t ARTIFACT_VERSION = 2;
+constexpr size_t HEADER_SIZE = 8 + 4 + 4 + 8 + 8;
+constexpr size_t SOURCE_ENTRY_SIZE = 8 + 4;
+
+/**
+ * Read-only memory mapping of a whole file.
+ */
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw LibraryError("cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw LibraryError("cannot stat " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+      void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        throw LibraryError("cannot map " + path);
+      }
+      data_ = static_cast<const char *>(p);
+    }
+    ::close(fd);
+  }
+
+  ~MappedFile() {
+    if (data_) {
+      ::munmap(const_cast<char *>(data_), size_);
+    }
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Fields are little-endian on disk, as on every host we build for
+template <typename T> T read_field(const char *p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+} // namespace
+
+uint64_t content_hash(const char *data, size_t size) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+Library load_library(const std::string &artifact_path) {
+  MappedFile file(artifact_path);
+  const char *data = file.data();
+  size_t size = file.size();
+
+  if (size < HEADER_SIZE) {
+    throw LibraryError(artifact_path + ": truncated header");
+  }
+  if (std::memcmp(data, ARTIFACT_MAGIC, sizeof(ARTIFACT_MAGIC)) != 0) {
+    throw LibraryError(artifact_path + ": not a library artifact");
+  }
+  uint32_t version = read_field<uint32_t>(data + 8);
+  if (version != ARTIFACT_VERSION) {
+    throw LibraryError(artifact_path + ": unsupported artifact version " +
+                       std::to_string(version));
+  }
+  uint32_t count = read_field<uint32_t>(data + 12);
+  uint64_t offset = read_field<uint64_t>(data + 16);
+  uint64_t payload_size = read_field<uint64_t>(data + 24);
+  if (offset > size || payload_size > size - offset) {
+    throw LibraryError(artifact_path + ": truncated payload");
+  }
+
+  Library lib;
+  lib.path = artifact_path;
+  fs::path base = fs::absolute(artifact_path).parent_path();
+
+  size_t pos = HEADER_SIZE;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (pos + SOURCE_ENTRY_SIZE > offset) {
+      throw LibraryError(artifact_path + ": truncated source table");
+    }
+    uint64_t hash = read_field<uint64_t>(data + pos);
+    uint32_t length = read_field<uint32_t>(data + pos + 8);
+    pos += SOURCE_ENTRY_SIZE;
+    if (pos + length > offset) {
+      throw LibraryError(artifact_path + ": truncated source table");
+    }
+    fs::path source = (base / std::string(data + pos, length)).lexically_normal();
+    pos += length;
+    lib.sources.emplace_back(source.string(), hash);
+  }
+
+  // An artifact is only valid while every source it was built from is
+  // byte-for-byte unchanged
+  for (const auto &[source, hash] : lib.sources) {
+    if (!fs::exists(source)) {
+      throw LibraryError(artifact_path + " is stale: " + source +
+                         " no longer exists");
+    }
+    MappedFile src(source);
+    if (content_hash(src.data(), src.size()) != hash) {
+      throw LibraryError(artifact_path + " is stale: " + source +
+                         " has changed, recompile with python/library.py");
+    }
+  }
+
+  try {
+    nlohmann::json payload =
+        nlohmann::json::parse(data + offset, data + offset + payload_size);
+    lib.theorems = payload.value("theorems", nlohmann::json::object());
+  } catch (const nlohmann::json::parse_error &e) {
+    throw LibraryError(artifact_path + ": corrupt payload: " + e.what());
+  }
+  return lib;
+}
@@ -0,0 +1,43 @@
+/*
+ * Proof Checker - Precompiled Theorem Libraries
+ *
+ * Reads the binary library artifacts written by python/library.py. An
+ * artifact holds theorem ASTs, their verified status and the content hash
+ * of every source file the library was built from; see that module for the
+ * exact layout.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+class LibraryError : public std::runtime_error {
+public:
+  explicit LibraryError(const std::string &msg)
+      : std::runtime_error("Library error: " + msg) {}
+};
+
+struct Library {
+  std::string path;
+  // Absolute source path and its FNV-1a content hash
+  std::vector<std::pair<std::string, uint64_t>> sources;
+  // Theorem name -> {assumptions, conclusion, var_types, status}
+  nlohmann::json theorems;
+};
+
+/**
+ * 64-bit FNV-1a hash (matches python/library.py).
+ */
+uint64_t content_hash(const char *data, size_t size);
+
+/**
+ * Memory-map and decode a library artifact.
+ * Throws LibraryError if the artifact is malformed or stale, i.e. any of
+ * its recorded sources is missing or has a different content hash.
+ */
+Library load_library(const std::string &artifact_path);
@@ -0,0 +1,401 @@
+/*
+ * Proof Checker - C++ Prover
+ *
+ * Command-line entry point: checks one JSON request from stdin, or serves
+ * requests line by line as a long-running engine.
+ *
+ * Build: mkdir build && cd build && cmake .. && make
+ * Usage: ./prover [--cache-dir DIR | --no-cache] [--max-memory-mb N]
+ *                 [--trace OUT.json] < input.json
+ *        ./prover --serve [--metrics-port N] [--metrics-socket PATH]
+ *                 [--context-pool N] [--context-reuse N] [--preload LIB.plib]
+ *                 [--prefork N [--worker-max-rss-mb N]]
+ *                            (one JSON request/response per line)
+ */
+
+#include "library.hpp"
+#include "metrics.hpp"
+#include "prefork.hpp"
+#include "prover.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Default theorem cache location: $XDG_CACHE_HOME/proofchecker, falling
+ * back to ~/.cache/proofchecker.
+ */
+std::string default_cache_dir() {
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME")) {
+    return std::string(xdg) + "/proofchecker";
+  }
+  if (const char *home = std::getenv("HOME")) {
+    return std::string(home) + "/.cache/proofchecker";
+  }
+  return "";
+}
+
+/**
+ * Record a finished request in the daemon metrics. A check that Z3 gave
+ * up on because of "timeout_ms" counts as status "timeout".
+ */
+void observe_request(const json &result, Timings::Clock::time_point received,
+                     const Timings *timings,
+                     const MemoryUsage *memory = nullptr) {
+  std::string status = result.value("status", "error");
+  if (status == "unknown" && result.value("reason", "") == "timeout") {
+    status = "timeout";
+  }
+  metrics().observe_request(status, Timings::since(received) / 1e6);
+  if (timings) {
+    metrics().observe_phase("decode", timings->decode / 1e6);
+    metrics().observe_phase("validate", timings->validate / 1e6);
+    metrics().observe_phase("theorems", timings->theorems / 1e6);
+    metrics().observe_phase("translate", timings->translate / 1e6);
+    metrics().observe_phase("solve", timings->solve / 1e6);
+    metrics().observe_phase("model", timings->model / 1e6);
+  }
+  if (memory) {
+    metrics().observe_memory(memory->ast,
+                             std::max(memory->z3_translate, memory->z3_solve));
+  }
+}
+
+/**
+ * Long-running mode: one JSON request per input line, one JSON response
+ * per output line. Sessions and the theorem cache stay warm between
+ * requests; a request's "id" is echoed back in its response.
+ *
+ * A request with "stream": true is additionally answered with one
+ * {"id", "event": "step", "step_result"} line per step as soon as it has
+ * been checked, ahead of the response itself.
+ *
+ * Requests are read while earlier ones are being solved, so they can be
+ * cancelled: a request for a session supersedes every earlier request of
+ * that session still queued or running, and {"cancel": id} cancels the
+ * request with that id. Cancelled requests are answered with status
+ * "cancelled".
+ *
+ * Every request is recorded in metrics(), which main() can expose with
+ * --metrics-port or --metrics-socket.
+ */
+int serve() {
+  struct Pending {
+    json req;
+    std::shared_ptr<CancelToken> token;
+    Timings::Clock::time_point received;
+    Timings timings;
+    MemoryUsage memory;
+  };
+
+  std::mutex out_mutex;
+  auto emit = [&out_mutex](const json &message) {
+    std::lock_guard<std::mutex> lock(out_mutex);
+    std::cout << message << std::endl;
+  };
+  auto respond = [&emit](const json &req, json result) {
+    if (req.is_object() && req.contains("id")) {
+      result["id"] = req["id"];
+    }
+    emit(result);
+  };
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<Pending> queue;
+  std::optional<Pending> running;
+  bool closed = false;
+
+  // Requests are solved one at a time, in order: sessions are not shared
+  // between threads
+  std::thread worker([&]() {
+    tracer().name_thread("worker");
+    while (true) {
+      Pending job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&] { return closed || !queue.empty(); });
+        if (queue.empty()) {
+          return;
+        }
+        job = std::move(queue.front());
+        queue.pop_front();
+        running = job;
+        metrics().set_queue_depth(queue.size());
+        metrics().set_in_flight(1);
+      }
+
+      StepCallback on_step;
+      if (job.req.is_object() && job.req.value("stream", false)) {
+        on_step = [&emit, &job](const json &step_result) {
+          json event = {{"event", "step"}, {"step_result", step_result}};
+          if (job.req.contains("id")) {
+            event["id"] = job.req["id"];
+          }
+          emit(event);
+        };
+      }
+      json trace_args = json::object();
+      if (job.req.is_object() && job.req.contains("id")) {
+        trace_args["id"] = job.req["id"];
+      }
+      if (tracer().enabled()) {
+        tracer().complete("queued", job.received, Tracer::Clock::now(),
+                          trace_args);
+      }
+      TraceSpan span("request");
+      if (trace_args.contains("id")) {
+        span.arg("id", trace_args["id"]);
+      }
+      json result = prove(job.req, on_step, job.token.get(), &job.timings,
+                          &job.memory);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        running.reset();
+        metrics().set_in_flight(0);
+      }
+      respond(job.req, result);
+      span.arg("status", result.value("status", "error"));
+      observe_request(result, job.received, &job.timings, &job.memory);
+    }
+  });
+
+  // Cancels a queued or running request; caller holds the lock
+  auto cancel_if = [&](const std::function<bool(const json &)> &match) {
+    for (auto it = queue.begin(); it != queue.end();) {
+      if (match(it->req)) {
+        json result = cancelled_response();
+        respond(it->req, result);
+        observe_request(result, it->received, nullptr);
+        it = queue.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    metrics().set_queue_depth(queue.size());
+    if (running && match(running->req)) {
+      running->token->cancel();
+    }
+  };
+
+  tracer().name_thread("reader");
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    Timings::Clock::time_point received = Timings::Clock::now();
+    json req;
+    try {
+      TraceSpan span("decode");
+      req = json::parse(line);
+    } catch (const json::parse_error &e) {
+      json result = {{"ok", false},
+                     {"status", "error"},
+                     {"error", std::string("Invalid JSON: ") + e.what()}};
+      emit(result);
+      observe_request(result, received, nullptr);
+      continue;
+    }
+    Timings timings;
+    timings.decode = Timings::since(received);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (req.is_object() && req.contains("cancel")) {
+      const json &id = req["cancel"];
+      cancel_if([&id](const json &r) {
+        return r.contains("id") && r["id"] == id;
+      });
+      continue;
+    }
+    if (req.is_object() && req.contains("session")) {
+      const json &session = req["session"];
+      cancel_if([&session](const json &r) {
+        return r.contains("session") && r["session"] == session;
+      });
+    }
+    queue.push_back({req, std::make_shared<CancelToken>(), received, timings, {}});
+    metrics().set_queue_depth(queue.size());
+    ready.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+  }
+  ready.notify_one();
+  worker.join();
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  std::string cache_dir = default_cache_dir();
+  bool serve_mode = false;
+  int metrics_port = 0;
+  std::string metrics_socket;
+  std::string trace_path;
+  int context_pool = 2;
+  int context_reuse = 100;
+  int max_memory_mb = 0;
+  std::vector<std::string> preload;
+  int prefork_workers = 0;
+  int worker_max_rss_mb = 0;
+  bool pool_options = false;
+  bool usage_error = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--cache-dir" && i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (arg == "--no-cache") {
+      cache_dir.clear();
+    } else if (arg == "--serve") {
+      serve_mode = true;
+    } else if (arg == "--metrics-port" && i + 1 < argc) {
+      metrics_port = std::atoi(argv[++i]);
+      usage_error = usage_error || metrics_port <= 0 || metrics_port > 65535;
+    } else if (arg == "--metrics-socket" && i + 1 < argc) {
+      metrics_socket = argv[++i];
+    } else if (arg == "--context-pool" && i + 1 < argc) {
+      context_pool = std::atoi(argv[++i]);
+      usage_error = usage_error || context_pool < 0;
+      pool_options = true;
+    } else if (arg == "--context-reuse" && i + 1 < argc) {
+      context_reuse = std::atoi(argv[++i]);
+      usage_error = usage_error || context_reuse <= 0;
+      pool_options = true;
+    } else if (arg == "--max-memory-mb" && i + 1 < argc) {
+      max_memory_mb = std::atoi(argv[++i]);
+      usage_error = usage_error || max_memory_mb <= 0;
+    } else if (arg == "--preload" && i + 1 < argc) {
+      preload.push_back(argv[++i]);
+    } else if (arg == "--prefork" && i + 1 < argc) {
+      prefork_workers = std::atoi(argv[++i]);
+      usage_error = usage_error || prefork_workers <= 0;
+    } else if (arg == "--worker-max-rss-mb" && i + 1 < argc) {
+      worker_max_rss_mb = std::atoi(argv[++i]);
+      usage_error = usage_error || worker_max_rss_mb <= 0;
+    } else if (arg == "--trace" && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else {
+      usage_error = true;
+    }
+  }
+  if (!serve_mode && (metrics_port || !metrics_socket.empty() || pool_options ||
+                      !preload.empty() || prefork_workers)) {
+    usage_error = true;
+  }
+  // Workers are separate processes: metrics and traces would be per worker
+  if (prefork_workers
+          ? metrics_port || !metrics_socket.empty() || !trace_path.empty()
+          : worker_max_rss_mb > 0) {
+    usage_error = true;
+  }
+  if (usage_error) {
+    std::cerr << "Usage: prover [--serve [--metrics-port N] [--metrics-socket PATH]"
+                 " [--context-pool N] [--context-reuse N] [--preload LIB.plib]"
+                 " [--prefork N [--worker-max-rss-mb N]]]"
+                 " [--cache-dir DIR | --no-cache] [--max-memory-mb N]"
+                 " [--trace OUT.json] < input.json"
+              << std::endl;
+    return 2;
+  }
+
+  if (!trace_path.empty()) {
+    tracer().enable();
+  }
+  set_memory_limit(static_cast<size_t>(max_memory_mb));
+  // Trace events are written once the run is over
+  auto write_trace = [&trace_path](int status) {
+    if (!trace_path.empty() && !tracer().write(trace_path)) {
+      std::cerr << "Cannot write trace to " << trace_path << std::endl;
+    }
+    return status;
+  };
+
+  if (!cache_dir.empty()) {
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    if (!ec) {
+      open_theorem_cache(cache_dir + "/theorems");
+    }
+  }
+
+  if (serve_mode) {
+    std::vector<std::unique_ptr<MetricsServer>> exporters;
+    try {
+      if (metrics_port) {
+        exporters.push_back(MetricsServer::tcp(metrics_port));
+      }
+      if (!metrics_socket.empty()) {
+        exporters.push_back(MetricsServer::unix_socket(metrics_socket));
+      }
+    } catch (const MetricsError &e) {
+      std::cerr << e.what() << std::endl;
+      return 2;
+    }
+    configure_context_pool(static_cast<size_t>(context_pool),
+                           static_cast<size_t>(context_reuse));
+    try {
+      for (const auto &path : preload) {
+        preload_library(path);
+      }
+    } catch (const LibraryError &e) {
+      std::cerr << e.what() << std::endl;
+      return 2;
+    }
+    if (prefork_workers) {
+      // Forked workers start from everything loaded so far
+      warm_up();
+      PreforkOptions options;
+      options.workers = static_cast<size_t>(prefork_workers);
+      options.max_rss_mb = static_cast<size_t>(worker_max_rss_mb);
+      options.max_sessions = MAX_SESSIONS;
+      return prefork(options, serve);
+    }
+    return write_trace(serve());
+  }
+
+  try {
+    // Read everything first so decode time excludes waiting on the pipe
+    std::string input((std::istreambuf_iterator<char>(std::cin)),
+                      std::istreambuf_iterator<char>());
+    tracer().name_thread("main");
+    Timings timings;
+    Timings::Clock::time_point start = Timings::Clock::now();
+    json req;
+    {
+      TraceSpan span("decode");
+      req = json::parse(input);
+    }
+    timings.decode = Timings::since(start);
+
+    json result;
+    {
+      TraceSpan span("request");
+      result = prove(req, nullptr, nullptr, &timings);
+      span.arg("status", result.value("status", "error"));
+    }
+    std::cout << result << std::endl;
+
+    return write_trace(result["ok"] ? 0 : 1);
+
+  } catch (const json::parse_error &e) {
+    json error = {{"ok", false},
+                  {"status", "error"},
+                  {"error", std::string("Invalid JSON: ") + e.what()}};
+    std::cout << error << std::endl;
+    return write_trace(1);
+  }
+}
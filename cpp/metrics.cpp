@@ -0,0 +1,300 @@
+/*
+ * Proof Checker - Daemon Metrics
+ *
+ * The exposition endpoint is a minimal HTTP/1.0 responder: one request per
+ * connection, answered and closed, which is all a Prometheus scraper (or
+ * curl --unix-socket) needs.
+ */
+
+#include "metrics.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <z3.h>
+
+namespace {
+
+// Longest one scrape may take to send its request, or to take the
+// response; the server answers one client at a time, so a client that
+// stalls must not hold it up for longer
+constexpr std::chrono::milliseconds CLIENT_TIMEOUT{2000};
+
+// Upper bounds in seconds; +Inf is implicit
+const std::vector<double> BUCKETS = {0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                     0.025,  0.05,  0.1,    0.25,  0.5,
+                                     1,      2.5,   5,      10,    30};
+
+// Upper bounds in bytes for memory histograms: 64 KiB to 16 GiB
+std::vector<double> byte_buckets() {
+  std::vector<double> bounds;
+  for (double b = 64 * 1024.0; b <= 16 * 1024.0 * 1024 * 1024; b *= 4) {
+    bounds.push_back(b);
+  }
+  return bounds;
+}
+
+std::string format_double(double value) {
+  std::ostringstream os;
+  os << std::setprecision(15) << value;
+  return os.str();
+}
+
+std::string with_label(const std::string &labels, const std::string &extra) {
+  return "{" + (labels.empty() ? extra : labels + "," + extra) + "}";
+}
+
+void write_all(int fd, const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return;
+    }
+    sent += static_cast<size_t>(n);
+  }
+}
+
+} // namespace
+
+Histogram::Histogram() : Histogram(BUCKETS) {}
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)), counts_(bounds_.size(), 0) {}
+
+void Histogram::observe(double value) {
+  for (size_t i = 0; i < bounds_.size(); ++i) {
+    if (value <= bounds_[i]) {
+      ++counts_[i];
+    }
+  }
+  sum_ += value;
+  ++count_;
+}
+
+void Histogram::render(std::string &out, const std::string &name,
+                       const std::string &labels) const {
+  for (size_t i = 0; i < bounds_.size(); ++i) {
+    out += name + "_bucket" +
+           with_label(labels, "le=\"" + format_double(bounds_[i]) + "\"") +
+           " " + std::to_string(counts_[i]) + "\n";
+  }
+  out += name + "_bucket" + with_label(labels, "le=\"+Inf\"") + " " +
+         std::to_string(count_) + "\n";
+  std::string plain = labels.empty() ? "" : "{" + labels + "}";
+  out += name + "_sum" + plain + " " + format_double(sum_) + "\n";
+  out += name + "_count" + plain + " " + std::to_string(count_) + "\n";
+}
+
+Metrics::Metrics() : ast_bytes_(byte_buckets()), z3_bytes_(byte_buckets()) {}
+
+void Metrics::observe_request(const std::string &status, double seconds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++requests_[status];
+  latency_.observe(seconds);
+}
+
+void Metrics::observe_phase(const std::string &phase, double seconds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  phases_[phase].observe(seconds);
+}
+
+void Metrics::count_cache(const std::string &cache, bool hit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++(hit ? cache_hits_ : cache_misses_)[cache];
+  // Keep both series present once a cache has been used
+  (hit ? cache_misses_ : cache_hits_)[cache] += 0;
+}
+
+void Metrics::observe_memory(size_t ast_bytes, size_t z3_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ast_bytes_.observe(static_cast<double>(ast_bytes));
+  z3_bytes_.observe(static_cast<double>(z3_bytes));
+}
+
+std::string Metrics::render() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string out;
+
+  out += "# HELP prover_requests_total Checked requests by result status.\n";
+  out += "# TYPE prover_requests_total counter\n";
+  for (const auto &[status, count] : requests_) {
+    out += "prover_requests_total{status=\"" + status + "\"} " +
+           std::to_string(count) + "\n";
+  }
+
+  out += "# HELP prover_request_duration_seconds End-to-end request latency.\n";
+  out += "# TYPE prover_request_duration_seconds histogram\n";
+  latency_.render(out, "prover_request_duration_seconds", "");
+
+  out += "# HELP prover_phase_duration_seconds Time per request spent in each phase.\n";
+  out += "# TYPE prover_phase_duration_seconds histogram\n";
+  for (const auto &[phase, histogram] : phases_) {
+    histogram.render(out, "prover_phase_duration_seconds",
+                     "phase=\"" + phase + "\"");
+  }
+
+  out += "# HELP prover_cache_hits_total Cache lookups answered from the cache.\n";
+  out += "# TYPE prover_cache_hits_total counter\n";
+  for (const auto &[cache, count] : cache_hits_) {
+    out += "prover_cache_hits_total{cache=\"" + cache + "\"} " +
+           std::to_string(count) + "\n";
+  }
+  out += "# HELP prover_cache_misses_total Cache lookups that had to be solved.\n";
+  out += "# TYPE prover_cache_misses_total counter\n";
+  for (const auto &[cache, count] : cache_misses_) {
+    out += "prover_cache_misses_total{cache=\"" + cache + "\"} " +
+           std::to_string(count) + "\n";
+  }
+
+  out += "# HELP prover_queue_depth Requests waiting to be checked.\n";
+  out += "# TYPE prover_queue_depth gauge\n";
+  out += "prover_queue_depth " + std::to_string(queue_depth_.load()) + "\n";
+  out += "# HELP prover_in_flight Requests being checked.\n";
+  out += "# TYPE prover_in_flight gauge\n";
+  out += "prover_in_flight " + std::to_string(in_flight_.load()) + "\n";
+  out += "# HELP prover_z3_memory_bytes Estimated memory allocated by Z3.\n";
+  out += "# TYPE prover_z3_memory_bytes gauge\n";
+  out += "prover_z3_memory_bytes " +
+         std::to_string(Z3_get_estimated_alloc_size()) + "\n";
+  out += "# HELP prover_peak_rss_bytes Resident set size high-water mark.\n";
+  out += "# TYPE prover_peak_rss_bytes gauge\n";
+  out += "prover_peak_rss_bytes " + std::to_string(peak_rss_bytes()) + "\n";
+
+  out += "# HELP prover_request_ast_bytes Estimated size of each decoded request.\n";
+  out += "# TYPE prover_request_ast_bytes histogram\n";
+  ast_bytes_.render(out, "prover_request_ast_bytes", "");
+  out += "# HELP prover_request_z3_memory_bytes Peak growth of the Z3 allocation estimate during each request.\n";
+  out += "# TYPE prover_request_z3_memory_bytes histogram\n";
+  z3_bytes_.render(out, "prover_request_z3_memory_bytes", "");
+  return out;
+}
+
+Metrics &metrics() {
+  static Metrics instance;
+  return instance;
+}
+
+size_t peak_rss_bytes() {
+  struct rusage usage;
+  if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // ru_maxrss is in kilobytes on Linux
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+std::unique_ptr<MetricsServer> MetricsServer::tcp(int port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw MetricsError("cannot create socket");
+  }
+  int reuse = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      ::listen(fd, 16) != 0) {
+    ::close(fd);
+    throw MetricsError("cannot listen on 127.0.0.1:" + std::to_string(port) +
+                       ": " + std::strerror(errno));
+  }
+  return std::unique_ptr<MetricsServer>(new MetricsServer(fd, ""));
+}
+
+std::unique_ptr<MetricsServer> MetricsServer::unix_socket(const std::string &path) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw MetricsError("socket path too long: " + path);
+  }
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw MetricsError("cannot create socket");
+  }
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  ::unlink(path.c_str());
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      ::listen(fd, 16) != 0) {
+    ::close(fd);
+    throw MetricsError("cannot listen on " + path + ": " + std::strerror(errno));
+  }
+  return std::unique_ptr<MetricsServer>(new MetricsServer(fd, path));
+}
+
+MetricsServer::MetricsServer(int fd, std::string unix_path)
+    : fd_(fd), unix_path_(std::move(unix_path)) {
+  thread_ = std::thread([this] { run(); });
+}
+
+MetricsServer::~MetricsServer() {
+  // Unblocks accept()
+  ::shutdown(fd_, SHUT_RDWR);
+  thread_.join();
+  ::close(fd_);
+  if (!unix_path_.empty()) {
+    ::unlink(unix_path_.c_str());
+  }
+}
+
+void MetricsServer::run() {
+  while (true) {
+    int client = ::accept(fd_, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+
+    timeval send_timeout{};
+    send_timeout.tv_sec = CLIENT_TIMEOUT.count() / 1000;
+    send_timeout.tv_usec = (CLIENT_TIMEOUT.count() % 1000) * 1000;
+    ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &send_timeout,
+                 sizeof(send_timeout));
+
+    // Only the request line matters; headers are read and ignored
+    auto deadline = std::chrono::steady_clock::now() + CLIENT_TIMEOUT;
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.find("\n\n") == std::string::npos && request.size() < 8192) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      pollfd readable{client, POLLIN, 0};
+      if (left.count() <= 0 ||
+          ::poll(&readable, 1, static_cast<int>(left.count())) <= 0) {
+        break;
+      }
+      ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+      if (n <= 0) {
+        break;
+      }
+      request.append(buf, static_cast<size_t>(n));
+    }
+
+    std::string response;
+    if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET / ", 0) == 0) {
+      std::string body = metrics().render();
+      response = "HTTP/1.0 200 OK\r\n"
+                 "Content-Type: text/plain; version=0.0.4\r\n"
+                 "Content-Length: " + std::to_string(body.size()) +
+                 "\r\n\r\n" + body;
+    } else {
+      response = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    }
+    write_all(client, response);
+    ::close(client);
+  }
+}
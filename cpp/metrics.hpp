@@ -0,0 +1,106 @@
+/*
+ * Proof Checker - Daemon Metrics
+ *
+ * Counters, gauges and latency histograms for `prover --serve`, rendered
+ * in the Prometheus text exposition format and served over HTTP on a
+ * local TCP port or a Unix socket.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MetricsError : public std::runtime_error {
+public:
+  explicit MetricsError(const std::string &msg)
+      : std::runtime_error("Metrics error: " + msg) {}
+};
+
+/**
+ * Cumulative histogram with fixed bucket bounds (seconds).
+ */
+class Histogram {
+public:
+  Histogram();
+  // Custom upper bounds (e.g. bytes), ascending
+  explicit Histogram(std::vector<double> bounds);
+  void observe(double value);
+  // Appends the _bucket/_sum/_count series; labels is "" or `key="value"`
+  void render(std::string &out, const std::string &name,
+              const std::string &labels) const;
+
+private:
+  std::vector<double> bounds_;
+  std::vector<uint64_t> counts_;
+  double sum_ = 0;
+  uint64_t count_ = 0;
+};
+
+/**
+ * Process-wide metrics registry. All methods are thread-safe.
+ */
+class Metrics {
+public:
+  Metrics();
+
+  // A finished request: its result status and end-to-end latency
+  void observe_request(const std::string &status, double seconds);
+  // Time one request spent in a phase (decode, validate, theorems, ...)
+  void observe_phase(const std::string &phase, double seconds);
+  void count_cache(const std::string &cache, bool hit);
+  // Memory of a finished request: its decoded AST and Z3's peak growth
+  void observe_memory(size_t ast_bytes, size_t z3_bytes);
+  void set_queue_depth(size_t depth) { queue_depth_ = depth; }
+  void set_in_flight(size_t checks) { in_flight_ = checks; }
+
+  std::string render() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::map<std::string, uint64_t> requests_;
+  Histogram latency_;
+  std::map<std::string, Histogram> phases_;
+  std::map<std::string, uint64_t> cache_hits_;
+  std::map<std::string, uint64_t> cache_misses_;
+  Histogram ast_bytes_;
+  Histogram z3_bytes_;
+  std::atomic<size_t> queue_depth_{0};
+  std::atomic<size_t> in_flight_{0};
+};
+
+Metrics &metrics();
+
+// The process's resident set size high-water mark, in bytes
+size_t peak_rss_bytes();
+
+/**
+ * Answers HTTP GET /metrics with metrics().render() on a background
+ * thread. Stops and closes its socket when destroyed.
+ */
+class MetricsServer {
+public:
+  // Listen on 127.0.0.1:port
+  static std::unique_ptr<MetricsServer> tcp(int port);
+  // Listen on a Unix socket, replacing a stale socket file at path
+  static std::unique_ptr<MetricsServer> unix_socket(const std::string &path);
+
+  MetricsServer(const MetricsServer &) = delete;
+  MetricsServer &operator=(const MetricsServer &) = delete;
+  ~MetricsServer();
+
+private:
+  MetricsServer(int fd, std::string unix_path);
+  void run();
+
+  int fd_ = -1;
+  std::string unix_path_;
+  std::thread thread_;
+};
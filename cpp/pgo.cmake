@@ -0,0 +1,38 @@
+# Two-stage profile-guided build of the prover, as one command:
+#
+#   cmake -P cpp/pgo.cmake
+#   cmake -DBUILD_DIR=/tmp/pgo -DPGO_CMAKE_ARGS="-DPROVER_LTO=ON" -P cpp/pgo.cmake
+#
+# 1. Configure BUILD_DIR (default cpp/build-pgo) with PROVER_PGO=GENERATE
+#    and build pgo_train: the instrumented prover checks the perf gate's
+#    corpus, which writes the profile.
+# 2. Reconfigure the same directory with PROVER_PGO=USE and rebuild.
+#
+# PGO_CMAKE_ARGS (a ;-list) is passed to both configure steps.
+
+cmake_minimum_required(VERSION 3.14)
+
+set(SOURCE_DIR ${CMAKE_CURRENT_LIST_DIR})
+if(NOT BUILD_DIR)
+    set(BUILD_DIR ${SOURCE_DIR}/build-pgo)
+endif()
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        string(REPLACE ";" " " command "${ARGN}")
+        message(FATAL_ERROR "PGO build step failed: ${command}")
+    endif()
+endfunction()
+
+message(STATUS "PGO stage 1: instrumented build and training run")
+run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BUILD_DIR}
+    -DCMAKE_BUILD_TYPE=Release ${PGO_CMAKE_ARGS} -DPROVER_PGO=GENERATE)
+run(${CMAKE_COMMAND} --build ${BUILD_DIR} --parallel --target pgo_train)
+
+message(STATUS "PGO stage 2: optimized build")
+run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BUILD_DIR}
+    -DCMAKE_BUILD_TYPE=Release ${PGO_CMAKE_ARGS} -DPROVER_PGO=USE)
+run(${CMAKE_COMMAND} --build ${BUILD_DIR} --parallel)
+
+message(STATUS "PGO build done: ${BUILD_DIR}/prover")
@@ -0,0 +1,455 @@
+/*
+ * Proof Checker - Pre-forked Workers
+ *
+ * The supervisor is single-threaded: one poll() loop over its stdin and
+ * the pipes of every worker. It tags each request it forwards with its
+ * own "id", so responses, step events and cancellations can be routed no
+ * matter in which order a worker answers, and puts the client's id back
+ * on the way out.
+ */
+
+#include "prefork.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Worker {
+  pid_t pid = -1;
+  int in = -1;         // Write end of the worker's stdin
+  int out = -1;        // Read end of the worker's stdout
+  std::string outbox;  // Request lines not yet written to the worker
+  std::string inbox;   // Start of a response line not yet complete
+  size_t outstanding = 0;
+  size_t sessions = 0;   // Entries in the supervisor's session map
+  bool retiring = false; // Replaced; exits once its requests are answered
+};
+
+// The worker a session's requests go to
+struct Route {
+  Worker *worker;
+  uint64_t last_used;
+};
+
+// A request forwarded to a worker and not yet answered
+struct Forwarded {
+  Worker *worker;
+  json id; // The client's "id", or discarded if it sent none
+  json session;
+};
+
+// Resident set size of a live process, or 0 if it cannot be read
+size_t resident_bytes(pid_t pid) {
+  std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+  size_t pages = 0, resident = 0;
+  if (!(statm >> pages >> resident)) {
+    return 0;
+  }
+  return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+std::string describe_exit(int status) {
+  if (WIFSIGNALED(status)) {
+    return "Worker crashed (signal " + std::to_string(WTERMSIG(status)) + ")";
+  }
+  return "Worker exited with status " + std::to_string(WEXITSTATUS(status));
+}
+
+class Supervisor {
+public:
+  Supervisor(const PreforkOptions &options,
+             const std::function<int()> &worker_main)
+      : options_(options), worker_main_(worker_main) {}
+
+  int run() {
+    // A worker that dies mid-write must not take the supervisor with it
+    std::signal(SIGPIPE, SIG_IGN);
+    for (size_t i = 0; i < options_.workers; ++i) {
+      spawn();
+    }
+
+    std::string line_buffer;
+    char buffer[65536];
+    while (input_open_ || !workers_.empty()) {
+      std::vector<pollfd> fds;
+      std::vector<Worker *> owners;
+      if (input_open_) {
+        fds.push_back({STDIN_FILENO, POLLIN, 0});
+        owners.push_back(nullptr);
+      }
+      for (Worker &w : workers_) {
+        if (w.out >= 0) {
+          fds.push_back({w.out, POLLIN, 0});
+          owners.push_back(&w);
+        }
+        if (w.in >= 0 && !w.outbox.empty()) {
+          fds.push_back({w.in, POLLOUT, 0});
+          owners.push_back(&w);
+        }
+      }
+      if (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+        return 1;
+      }
+
+      for (size_t i = 0; i < fds.size(); ++i) {
+        if (!fds[i].revents) {
+          continue;
+        }
+        Worker *w = owners[i];
+        if (w && w->pid < 0) {
+          continue; // Reaped earlier in this round
+        }
+        if (!w) {
+          ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+          if (n < 0 && errno == EINTR) {
+            continue;
+          }
+          if (n <= 0) {
+            input_open_ = false;
+            if (!line_buffer.empty()) {
+              dispatch(line_buffer);
+            }
+            for (Worker &worker : workers_) {
+              close_input_when_drained(worker);
+            }
+            continue;
+          }
+          line_buffer.append(buffer, static_cast<size_t>(n));
+          for (size_t end; (end = line_buffer.find('\n')) != std::string::npos;) {
+            std::string line = line_buffer.substr(0, end);
+            line_buffer.erase(0, end + 1);
+            dispatch(line);
+          }
+        } else if (fds[i].events == POLLOUT) {
+          flush(*w);
+        } else {
+          ssize_t n = read(w->out, buffer, sizeof(buffer));
+          if (n < 0 && errno == EINTR) {
+            continue;
+          }
+          if (n <= 0) {
+            reap(*w);
+            continue;
+          }
+          w->inbox.append(buffer, static_cast<size_t>(n));
+          for (size_t end; (end = w->inbox.find('\n')) != std::string::npos;) {
+            std::string line = w->inbox.substr(0, end);
+            w->inbox.erase(0, end + 1);
+            relay(*w, line);
+          }
+        }
+      }
+      workers_.remove_if([](const Worker &w) { return w.pid < 0; });
+    }
+    return 0;
+  }
+
+private:
+  void spawn() {
+    int to_worker[2], from_worker[2];
+    if (pipe(to_worker) < 0) {
+      std::cerr << "pipe failed: " << std::strerror(errno) << std::endl;
+      return;
+    }
+    if (pipe(from_worker) < 0) {
+      std::cerr << "pipe failed: " << std::strerror(errno) << std::endl;
+      close(to_worker[0]);
+      close(to_worker[1]);
+      return;
+    }
+    // Anything still buffered would be written by the child too
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "fork failed: " << std::strerror(errno) << std::endl;
+      for (int fd : {to_worker[0], to_worker[1], from_worker[0], from_worker[1]}) {
+        close(fd);
+      }
+      return;
+    }
+    if (pid == 0) {
+      std::signal(SIGPIPE, SIG_DFL);
+      // Other workers' pipes must not stay open here, or they would never
+      // see end-of-file
+      for (Worker &w : workers_) {
+        close(w.in);
+        close(w.out);
+      }
+      dup2(to_worker[0], STDIN_FILENO);
+      dup2(from_worker[1], STDOUT_FILENO);
+      for (int fd : {to_worker[0], to_worker[1], from_worker[0], from_worker[1]}) {
+        close(fd);
+      }
+      int status = worker_main_();
+      std::cout.flush();
+      // Skip the supervisor's atexit handlers and static destructors
+      _exit(status);
+    }
+
+    close(to_worker[0]);
+    close(from_worker[1]);
+    fcntl(to_worker[1], F_SETFL, fcntl(to_worker[1], F_GETFL) | O_NONBLOCK);
+    Worker w;
+    w.pid = pid;
+    w.in = to_worker[1];
+    w.out = from_worker[0];
+    workers_.push_back(std::move(w));
+  }
+
+  void dispatch(const std::string &line) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      return;
+    }
+    json req;
+    try {
+      req = json::parse(line);
+    } catch (const json::parse_error &e) {
+      emit({{"ok", false},
+            {"status", "error"},
+            {"error", std::string("Invalid JSON: ") + e.what()}});
+      return;
+    }
+    if (!req.is_object()) {
+      // No id to route it by; prove() gives such a request this answer
+      emit({{"ok", false},
+            {"status", "error"},
+            {"error", "Missing 'claim' field"}});
+      return;
+    }
+
+    if (req.contains("cancel")) {
+      for (auto &[tag, f] : forwarded_) {
+        if (f.id == req["cancel"]) {
+          send(*f.worker, {{"cancel", tag}});
+        }
+      }
+      return;
+    }
+
+    json session = req.value("session", json());
+    Worker *target = nullptr;
+    if (!session.is_null()) {
+      auto it = sessions_.find(session.dump());
+      if (it != sessions_.end()) {
+        target = it->second.worker;
+      }
+    }
+    if (!target) {
+      for (Worker &w : workers_) {
+        if (!w.retiring && w.in >= 0 &&
+            (!target || w.outstanding < target->outstanding)) {
+          target = &w;
+        }
+      }
+    }
+    if (!target) {
+      emit(reply(client_id(req),
+                 {{"ok", false},
+                  {"status", "error"},
+                  {"error", "No worker available"}}));
+      return;
+    }
+    if (!session.is_null()) {
+      // The session's worker supersedes its own requests; any left on a
+      // retiring worker are cancelled here
+      for (auto &[tag, f] : forwarded_) {
+        if (f.session == session && f.worker != target) {
+          send(*f.worker, {{"cancel", tag}});
+        }
+      }
+      route(session.dump(), *target);
+    }
+
+    uint64_t tag = next_tag_++;
+    forwarded_[tag] = {target, client_id(req), session};
+    ++target->outstanding;
+    req["id"] = tag;
+    send(*target, req);
+  }
+
+  // Send session id to w from now on. Past max_sessions on w, forget the
+  // session w has used least recently: the worker drops the same one.
+  void route(const std::string &id, Worker &w) {
+    auto [it, added] = sessions_.try_emplace(id, Route{&w, 0});
+    if (!added && it->second.worker != &w) {
+      --it->second.worker->sessions;
+      it->second.worker = &w;
+      added = true;
+    }
+    it->second.last_used = ++clock_;
+    if (added) {
+      ++w.sessions;
+    }
+    if (options_.max_sessions && w.sessions > options_.max_sessions) {
+      auto oldest = sessions_.end();
+      for (auto i = sessions_.begin(); i != sessions_.end(); ++i) {
+        if (i->second.worker == &w &&
+            (oldest == sessions_.end() ||
+             i->second.last_used < oldest->second.last_used)) {
+          oldest = i;
+        }
+      }
+      sessions_.erase(oldest);
+      --w.sessions;
+    }
+  }
+
+  // A line from a worker: a step event or the response to a request
+  void relay(Worker &w, const std::string &line) {
+    json message;
+    try {
+      message = json::parse(line);
+    } catch (const json::parse_error &) {
+      return;
+    }
+    auto it = message.is_object() && message.contains("id")
+                  ? forwarded_.find(message["id"].get<uint64_t>())
+                  : forwarded_.end();
+    if (it == forwarded_.end()) {
+      return;
+    }
+    json id = it->second.id;
+    if (!message.contains("event")) {
+      forwarded_.erase(it);
+      --w.outstanding;
+      check_limits(w);
+    }
+    emit(reply(id, std::move(message)));
+  }
+
+  void check_limits(Worker &w) {
+    if (w.retiring || !options_.max_rss_mb ||
+        resident_bytes(w.pid) <= options_.max_rss_mb << 20) {
+      return;
+    }
+    retire(w);
+    if (input_open_) {
+      spawn();
+    }
+  }
+
+  // Stop giving w work; it exits once its outstanding requests are answered
+  void retire(Worker &w) {
+    w.retiring = true;
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+      it = it->second.worker == &w ? sessions_.erase(it) : std::next(it);
+    }
+    w.sessions = 0;
+    close_input_when_drained(w);
+  }
+
+  // The worker closed its stdout: it has exited or is about to
+  void reap(Worker &w) {
+    int status = 0;
+    waitpid(w.pid, &status, 0);
+    close(w.out);
+    if (w.in >= 0) {
+      close(w.in);
+    }
+    for (auto it = forwarded_.begin(); it != forwarded_.end();) {
+      if (it->second.worker == &w) {
+        emit(reply(it->second.id, {{"ok", false},
+                                   {"status", "error"},
+                                   {"error", describe_exit(status)}}));
+        it = forwarded_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    bool replace = !w.retiring && input_open_;
+    retire(w);
+    w.pid = w.in = w.out = -1;
+    if (replace) {
+      spawn();
+    }
+  }
+
+  void send(Worker &w, const json &message) {
+    if (w.in < 0) {
+      return;
+    }
+    w.outbox += message.dump();
+    w.outbox += '\n';
+    flush(w);
+  }
+
+  void flush(Worker &w) {
+    while (!w.outbox.empty()) {
+      ssize_t n = write(w.in, w.outbox.data(), w.outbox.size());
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          // The worker is gone; reap() answers what it had
+          w.outbox.clear();
+        }
+        break;
+      }
+      w.outbox.erase(0, static_cast<size_t>(n));
+    }
+    close_input_when_drained(w);
+  }
+
+  // Once a worker gets no more requests, end-of-file on its stdin lets it
+  // finish the ones it has and exit
+  void close_input_when_drained(Worker &w) {
+    if (w.in >= 0 && w.outbox.empty() && (w.retiring || !input_open_)) {
+      close(w.in);
+      w.in = -1;
+    }
+  }
+
+  static json client_id(const json &req) {
+    auto it = req.find("id");
+    return it == req.end() ? json(json::value_t::discarded) : *it;
+  }
+
+  static json reply(const json &id, json message) {
+    if (id.is_discarded()) {
+      message.erase("id");
+    } else {
+      message["id"] = id;
+    }
+    return message;
+  }
+
+  static void emit(const json &message) { std::cout << message << std::endl; }
+
+  PreforkOptions options_;
+  const std::function<int()> &worker_main_;
+  bool input_open_ = true;
+  std::list<Worker> workers_;
+  std::map<uint64_t, Forwarded> forwarded_;
+  std::map<std::string, Route> sessions_; // Session id (dumped) -> worker
+  uint64_t next_tag_ = 0;
+  uint64_t clock_ = 0; // Orders sessions_ by use
+};
+
+} // namespace
+
+int prefork(const PreforkOptions &options,
+            const std::function<int()> &worker_main) {
+  return Supervisor(options, worker_main).run();
+}
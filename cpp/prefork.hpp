@@ -0,0 +1,36 @@
+/*
+ * Proof Checker - Pre-forked Workers
+ *
+ * Runs `prover --serve` as a supervisor over N forked worker processes.
+ * The workers inherit the supervisor's warm state (preloaded libraries,
+ * the theorem cache, Z3's process-wide tables) copy-on-write, and a
+ * worker that crashes or outgrows its memory limit is replaced, so one
+ * bad request cannot take the engine down.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+struct PreforkOptions {
+  size_t workers = 2;
+  // Replace a worker once its resident set exceeds this (0: no limit)
+  size_t max_rss_mb = 0;
+  // Sessions a worker keeps before dropping its least recently used one;
+  // the supervisor forgets the same sessions (0: no limit)
+  size_t max_sessions = 0;
+};
+
+/**
+ * Serve the serve() line protocol on stdin and stdout with forked
+ * workers, each running worker_main with its stdin and stdout on pipes to
+ * the supervisor. Requests of one session go to the same worker; others
+ * go to the worker with the fewest requests outstanding. Requests still
+ * outstanding on a worker that dies are answered with an error.
+ *
+ * Call with no other threads running. Returns once stdin is closed and
+ * every worker has exited.
+ */
+int prefork(const PreforkOptions &options,
+            const std::function<int()> &worker_main);
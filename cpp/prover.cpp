@@ -3,54 +3,38 @@
  *
  * A native C++ theorem prover using Z3 SMT solver.
  * Mirrors the Python implementation with JSON input/output.
- *
- * Build: mkdir build && cd build && cmake .. && make
- * Usage: ./prover < input.json
  */
 
-#include <iostream>
+#include "prover.hpp"
+#include "library.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 #include <z3++.h>
 
-using json = nlohmann::json;
 using namespace z3;
 
-class ProofError : public std::runtime_error {
-public:
-  explicit ProofError(const std::string &msg) : std::runtime_error(msg) {}
-};
-
-class TermError : public ProofError {
-public:
-  explicit TermError(const std::string &msg)
-      : ProofError("Term error: " + msg) {}
-};
-
-class FormulaError : public ProofError {
-public:
-  explicit FormulaError(const std::string &msg)
-      : ProofError("Formula error: " + msg) {}
-};
-
-// Use std::map with expr stored via optional wrapper
-struct ExprWrapper {
-  std::optional<expr> e;
-  ExprWrapper() = default;
-  ExprWrapper(expr ex) : e(std::move(ex)) {}
-  operator expr() const { return *e; }
-};
-
-using Environment = std::map<std::string, ExprWrapper>;
-using VarTypes = std::map<std::string, std::string>;
-
 // Forward declarations
-expr term_to_z3(const json &t, context &ctx, Environment &env,
-                const VarTypes &var_types);
-expr formula_to_z3(const json &f, context &ctx, Environment &env,
-                   const VarTypes &var_types);
+json substitute(const json &f, const std::map<std::string, json> &mapping);
 
 /**
  * Get or create a variable in the environment.
@@ -276,6 +260,25 @@ expr formula_to_z3(const json &f, context &ctx, Environment &env,
     return implies(lhs, rhs);
   }
 
+  if (ty == "instantiate") {
+    if (!f.contains("vars") || !f.contains("args") || !f.contains("body")) {
+      throw FormulaError(
+          "Instantiate formula missing 'vars', 'args', or 'body' field");
+    }
+    if (f["vars"].size() != f["args"].size()) {
+      throw FormulaError("Instantiation of " + f.value("theorem", "theorem") +
+                         " expects " + std::to_string(f["vars"].size()) +
+                         " argument(s), got " +
+                         std::to_string(f["args"].size()));
+    }
+    std::map<std::string, json> mapping;
+    for (size_t i = 0; i < f["vars"].size(); ++i) {
+      mapping[f["vars"][i].get<std::string>()] = f["args"][i];
+    }
+    // Ground instance: no quantifier is handed to the solver
+    return formula_to_z3(substitute(f["body"], mapping), ctx, env, var_types);
+  }
+
   if (ty == "forall") {
     if (!f.contains("vars") || !f.contains("body")) {
       throw FormulaError("Forall formula missing 'vars' or 'body' field");
@@ -317,114 +320,2097 @@ expr formula_to_z3(const json &f, context &ctx, Environment &env,
   throw FormulaError("Unknown formula type: " + ty);
 }
 
+// Number of ranked premises sent to the solver on the first attempt
+constexpr size_t DEFAULT_PREMISE_LIMIT = 8;
+
 /**
- * Format a counterexample model.
+ * Collect the variable names occurring in a term or formula JSON object.
  */
-json format_model(const model &m, const Environment &env) {
-  json model_out = json::object();
-  for (const auto &[name, wrapper] : env) {
-    expr var = wrapper;
-    model_out[name] = m.eval(var, true).to_string();
+void collect_symbols(const json &f, std::set<std::string> &symbols) {
+  if (f.is_object()) {
+    auto type_it = f.find("type");
+    auto name_it = f.find("name");
+    if (type_it != f.end() && *type_it == "var" && name_it != f.end() &&
+        name_it->is_string()) {
+      symbols.insert(name_it->get<std::string>());
+    }
+    if (type_it != f.end() && *type_it == "instantiate") {
+      // The theorem's own parameters are replaced by the arguments
+      collect_symbols(f.value("args", json::array()), symbols);
+      std::set<std::string> body_symbols;
+      collect_symbols(f.value("body", json::object()), body_symbols);
+      for (const auto &v : f.value("vars", json::array())) {
+        body_symbols.erase(v.get<std::string>());
+      }
+      symbols.insert(body_symbols.begin(), body_symbols.end());
+      return;
+    }
+    for (auto it = f.begin(); it != f.end(); ++it) {
+      if (it.key() == "vars" && it->is_array()) {
+        for (const auto &v : *it) {
+          if (v.is_string()) {
+            symbols.insert(v.get<std::string>());
+          }
+        }
+      } else if (it->is_structured()) {
+        collect_symbols(*it, symbols);
+      }
+    }
+  } else if (f.is_array()) {
+    for (const auto &item : f) {
+      collect_symbols(item, symbols);
+    }
   }
-  return model_out;
 }
 
 /**
- * Main proof function.
+ * Return name_1, name_2, ...: the first variant not in avoid.
  */
-json prove(const json &req) {
-  try {
-    context ctx;
-    Environment env;
-    VarTypes var_types;
+std::string fresh_name(const std::string &name,
+                       const std::set<std::string> &avoid) {
+  for (size_t i = 1;; ++i) {
+    std::string candidate = name + "_" + std::to_string(i);
+    if (!avoid.count(candidate)) {
+      return candidate;
+    }
+  }
+}
 
-    // Parse variable types
-    if (req.contains("var_types") && req["var_types"].is_object()) {
-      for (auto &[name, type_val] : req["var_types"].items()) {
-        var_types[name] = type_val.get<std::string>();
+/**
+ * Simultaneously replace free variables in a term or formula.
+ * Substitution is capture-avoiding: a quantifier (or nested instantiation)
+ * that binds a variable occurring in a replacement term has that bound
+ * variable renamed first.
+ */
+json substitute(const json &f, const std::map<std::string, json> &mapping) {
+  if (f.is_array()) {
+    json result = json::array();
+    for (const auto &item : f) {
+      result.push_back(substitute(item, mapping));
+    }
+    return result;
+  }
+  if (!f.is_object() || mapping.empty()) {
+    return f;
+  }
+
+  std::string ty = f.value("type", "");
+  if (ty == "var") {
+    auto it = mapping.find(f.value("name", ""));
+    return it != mapping.end() ? it->second : f;
+  }
+
+  if (ty == "forall" || ty == "exists" || ty == "instantiate") {
+    json result = f;
+    if (ty == "instantiate") {
+      // Arguments are outside the binder
+      result["args"] = substitute(f.value("args", json::array()), mapping);
+    }
+    json bound = f.value("vars", json::array());
+    std::map<std::string, json> inner = mapping;
+    for (const auto &v : bound) {
+      inner.erase(v.get<std::string>());
+    }
+    if (inner.empty()) {
+      return result;
+    }
+
+    std::set<std::string> replacement_symbols;
+    for (const auto &[name, term] : inner) {
+      collect_symbols(term, replacement_symbols);
+    }
+    std::set<std::string> avoid = replacement_symbols;
+    collect_symbols(f.value("body", json::object()), avoid);
+    for (const auto &[name, term] : inner) {
+      avoid.insert(name);
+    }
+
+    json new_vars = json::array();
+    for (const auto &v : bound) {
+      std::string name = v.get<std::string>();
+      if (replacement_symbols.count(name)) {
+        std::string renamed = fresh_name(name, avoid);
+        avoid.insert(renamed);
+        inner[name] = {{"type", "var"}, {"name", renamed}};
+        new_vars.push_back(renamed);
+      } else {
+        new_vars.push_back(name);
       }
     }
+    result["vars"] = new_vars;
+    result["body"] = substitute(f.value("body", json::object()), inner);
+    return result;
+  }
 
-    // Initialize declared variables
-    if (req.contains("vars")) {
-      for (const auto &name_json : req["vars"]) {
-        std::string n = name_json.get<std::string>();
-        if (var_types.count(n) && var_types[n] == "Int") {
-          env[n] = ExprWrapper(ctx.int_const(n.c_str()));
+  json result = json::object();
+  for (auto it = f.begin(); it != f.end(); ++it) {
+    result[it.key()] =
+        it->is_structured() ? substitute(*it, mapping) : *it;
+  }
+  return result;
+}
+
+/**
+ * Free variables of a theorem in order of first occurrence (assumptions
+ * before conclusion); these are bound positionally by an instantiation.
+ * Mirrors theorem_params in python/parser.py.
+ */
+std::vector<std::string> theorem_params(const json &theorem) {
+  std::vector<std::string> params;
+  std::function<void(const json &, const std::set<std::string> &)> walk =
+      [&](const json &node, const std::set<std::string> &bound) {
+        if (node.is_array()) {
+          for (const auto &item : node) {
+            walk(item, bound);
+          }
+          return;
+        }
+        if (!node.is_object()) {
+          return;
+        }
+        std::string ty = node.value("type", "");
+        if (ty == "var") {
+          std::string name = node.value("name", "");
+          if (!bound.count(name) &&
+              std::find(params.begin(), params.end(), name) == params.end()) {
+            params.push_back(name);
+          }
+        } else if (ty == "forall" || ty == "exists" || ty == "instantiate") {
+          if (ty == "instantiate") {
+            walk(node.value("args", json::array()), bound);
+          }
+          std::set<std::string> inner = bound;
+          for (const auto &v : node.value("vars", json::array())) {
+            inner.insert(v.get<std::string>());
+          }
+          walk(node.value("body", json::object()), inner);
         } else {
-          env[n] = ExprWrapper(ctx.real_const(n.c_str()));
+          for (const char *key : {"lhs", "rhs", "arg", "args", "base", "exp"}) {
+            if (node.contains(key)) {
+              walk(node[key], bound);
+            }
+          }
         }
+      };
+  walk(theorem.at("assumptions"), {});
+  walk(theorem.at("conclusion"), {});
+  return params;
+}
+
+/**
+ * Order premises by relevance to a goal.
+ * A premise ranks higher the more symbols it shares with the goal; ties go
+ * to the premise with fewer unrelated symbols, then to source order.
+ */
+std::vector<const json *> rank_premises(const json &premises,
+                                        const json &goal) {
+  std::set<std::string> goal_symbols;
+  collect_symbols(goal, goal_symbols);
+
+  std::vector<std::tuple<size_t, size_t, size_t, const json *>> scored;
+  size_t idx = 0;
+  for (const auto &p : premises) {
+    if (!p.is_object() || !p.contains("formula")) {
+      throw FormulaError("Premise missing 'formula' field");
+    }
+    std::set<std::string> symbols;
+    collect_symbols(p["formula"], symbols);
+    size_t overlap = 0;
+    for (const auto &name : symbols) {
+      overlap += goal_symbols.count(name);
+    }
+    scored.emplace_back(symbols.size() - overlap, overlap, idx++, &p);
+  }
+  std::stable_sort(scored.begin(), scored.end(),
+                   [](const auto &a, const auto &b) {
+                     if (std::get<1>(a) != std::get<1>(b))
+                       return std::get<1>(a) > std::get<1>(b);
+                     return std::get<0>(a) < std::get<0>(b);
+                   });
+
+  std::vector<const json *> ranked;
+  for (const auto &entry : scored) {
+    ranked.push_back(std::get<3>(entry));
+  }
+  return ranked;
+}
+
+/**
+ * Build the implication a theorem contributes when applied:
+ * (all assumptions) => conclusion, or just the conclusion.
+ */
+json theorem_formula(const json &theorem) {
+  const json &assumptions = theorem.at("assumptions");
+  const json &conclusion = theorem.at("conclusion");
+  if (assumptions.empty()) {
+    return conclusion;
+  }
+  json lhs = assumptions.size() > 1
+                 ? json{{"type", "and"}, {"args", assumptions}}
+                 : assumptions[0];
+  return {{"type", "implies"}, {"lhs", lhs}, {"rhs", conclusion}};
+}
+
+/**
+ * Fill in premises given only by name from the loaded library theorems.
+ * A premise with "args" becomes an instantiation of the theorem.
+ */
+json resolve_premises(const json &premises, const json &library_theorems) {
+  json resolved = json::array();
+  for (const auto &p : premises) {
+    if (p.is_object() && !p.contains("formula") && p.contains("name")) {
+      std::string name = p["name"];
+      auto it = library_theorems.find(name);
+      if (it == library_theorems.end()) {
+        throw FormulaError("Unknown theorem: " + name);
+      }
+      json formula = theorem_formula(*it);
+      if (p.contains("args")) {
+        formula = {{"type", "instantiate"},
+                   {"theorem", name},
+                   {"vars", theorem_params(*it)},
+                   {"args", p["args"]},
+                   {"body", formula}};
       }
+      resolved.push_back({{"name", name}, {"formula", formula}});
+    } else {
+      resolved.push_back(p);
     }
+  }
+  return resolved;
+}
 
-    solver s(ctx);
+/**
+ * Verified theorem statuses keyed by canonical theorem hash.
+ * Entries are appended to a cache file so a library is verified once per
+ * machine, not once per run. Only definitive results (proven/disproven)
+ * are remembered.
+ */
+/**
+ * First line of the on-disk theorem cache. Bump the version whenever a
+ * change to translation or solving could change a theorem's status: a
+ * cache written under another version is discarded, not trusted.
+ */
+constexpr const char *THEOREM_CACHE_HEADER = "proofchecker-theorems 1";
 
-    // Add assumptions
-    if (req.contains("assumptions")) {
-      for (const auto &a : req["assumptions"]) {
-        s.add(formula_to_z3(a, ctx, env, var_types));
+class TheoremCache {
+public:
+  void open(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || line != THEOREM_CACHE_HEADER) {
+      // Missing, or from another engine version: start over
+      in.close();
+      std::ofstream out(path, std::ios::trunc);
+      out << THEOREM_CACHE_HEADER << '\n';
+      return;
+    }
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      uint64_t hash;
+      std::string status;
+      if (fields >> std::hex >> hash >> status) {
+        entries_[hash] = status;
       }
     }
+  }
 
-    // Get the claim
-    if (!req.contains("claim")) {
-      return {{"ok", false},
-              {"status", "error"},
-              {"error", "Missing 'claim' field"}};
+  std::optional<std::string> lookup(uint64_t hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(hash);
+    if (it == entries_.end()) {
+      return std::nullopt;
     }
+    return it->second;
+  }
 
-    expr claim = formula_to_z3(req["claim"], ctx, env, var_types);
+  void store(uint64_t hash, const std::string &status) {
+    if (status != "proven" && status != "disproven") {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!entries_.emplace(hash, status).second || path_.empty()) {
+      return;
+    }
+    std::ofstream out(path_, std::ios::app);
+    out << std::hex << hash << ' ' << status << '\n';
+  }
 
-    // Prove: assumptions => claim
-    // Check UNSAT of: assumptions AND (NOT claim)
-    s.add(!claim);
+private:
+  std::mutex mutex_;
+  std::map<uint64_t, std::string> entries_;
+  std::string path_;
+};
+
+TheoremCache &theorem_cache() {
+  static TheoremCache cache;
+  return cache;
+}
 
-    check_result result = s.check();
+void open_theorem_cache(const std::string &path) { theorem_cache().open(path); }
 
-    if (result == unsat) {
-      return {{"ok", true}, {"status", "proven"}};
+/**
+ * Canonical hash of a theorem: its assumptions, conclusion and the types
+ * of its variables under var_types. Independent of the theorem's name, so
+ * renaming or moving a theorem between libraries does not invalidate its
+ * status. Real is the default type, so a variable declared Real hashes as
+ * an undeclared one.
+ */
+uint64_t theorem_hash(const json &theorem, const VarTypes &var_types) {
+  std::set<std::string> symbols;
+  collect_symbols(theorem.at("assumptions"), symbols);
+  collect_symbols(theorem.at("conclusion"), symbols);
+
+  json types = json::object();
+  for (const auto &name : symbols) {
+    auto it = var_types.find(name);
+    if (it != var_types.end() && it->second != "Real") {
+      types[name] = it->second;
     }
+  }
 
-    if (result == sat) {
-      model m = s.get_model();
-      return {{"ok", false},
-              {"status", "disproven"},
-              {"model", format_model(m, env)}};
+  // json objects keep their keys sorted, so dump() is canonical
+  std::string text = json{{"assumptions", theorem.at("assumptions")},
+                          {"conclusion", theorem.at("conclusion")},
+                          {"var_types", types}}
+                         .dump();
+  return content_hash(text.data(), text.size());
+}
+
+/**
+ * Store the verified status a library artifact records for its theorems.
+ * A status only holds under the variable types it was verified under, so
+ * it is keyed by the types recorded with the theorem; a request that
+ * types the variables differently misses the cache and verifies the
+ * theorem under its own types.
+ */
+void seed_theorem_cache(const Library &lib) {
+  for (auto &[name, theorem] : lib.theorems.items()) {
+    if (theorem.value("status", "") == "proven") {
+      VarTypes types =
+          theorem.value("var_types", json::object()).get<VarTypes>();
+      theorem_cache().store(theorem_hash(theorem, types), "proven");
     }
+  }
+}
 
-    // result == unknown
-    return {{"ok", false},
-            {"status", "unknown"},
-            {"message", "Z3 could not determine satisfiability"}};
+/**
+ * Library artifacts loaded by preload_library(), keyed by the path as
+ * requests name it. Filled before serving and only read afterwards.
+ */
+std::map<std::string, Library> &preloaded_libraries() {
+  static std::map<std::string, Library> libraries;
+  return libraries;
+}
 
-  } catch (const ProofError &e) {
-    return {{"ok", false}, {"status", "error"}, {"error", e.what()}};
-  } catch (const z3::exception &e) {
-    return {{"ok", false},
-            {"status", "error"},
-            {"error", std::string("Z3 error: ") + e.msg()}};
-  } catch (const std::exception &e) {
-    return {{"ok", false},
-            {"status", "error"},
-            {"error", std::string("Internal error: ") + e.what()}};
+const Library *preloaded_library(const std::string &path) {
+  auto &libraries = preloaded_libraries();
+  auto it = libraries.find(path);
+  return it == libraries.end() ? nullptr : &it->second;
+}
+
+std::atomic<size_t> pool_capacity{2};
+std::atomic<size_t> pool_max_uses{100};
+
+/**
+ * Whether a JSON term, formula or request contains forall or exists.
+ */
+bool has_quantifier(const json &j) {
+  if (j.is_object()) {
+    auto type = j.find("type");
+    if (type != j.end() && type->is_string() &&
+        (*type == "forall" || *type == "exists")) {
+      return true;
+    }
+  }
+  if (j.is_structured()) {
+    for (const auto &child : j) {
+      if (has_quantifier(child)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Exclusive use of a Z3 context from the calling thread's pool. The
+ * context is taken from the idle ones (or created) and handed back when
+ * the lease ends, unless it has served pool_max_uses requests, the pool is
+ * full, or the lease ends by an exception (a cancelled or failed check);
+ * then it is destroyed. Every expression and solver made in the context
+ * must be gone before the lease is.
+ *
+ * Quantified obligations get a fresh context that is not pooled: Z3's
+ * quantifier instantiation depends on term ids, and in a used context
+ * they differ from run to run, which made latency erratic.
+ */
+class ContextLease {
+public:
+  explicit ContextLease(bool reuse = true)
+      : reuse_(reuse), exceptions_(std::uncaught_exceptions()) {
+    std::vector<Pooled> &idle = idle_contexts();
+    bool reused = reuse_ && !idle.empty();
+    if (reused) {
+      pooled_ = std::move(idle.back());
+      idle.pop_back();
+    } else {
+      pooled_.ctx = std::make_unique<context>();
+    }
+    ++pooled_.uses;
+    metrics().count_cache("context", reused);
+  }
+  ContextLease(const ContextLease &) = delete;
+  ContextLease &operator=(const ContextLease &) = delete;
+  ~ContextLease() {
+    std::vector<Pooled> &idle = idle_contexts();
+    if (reuse_ && std::uncaught_exceptions() == exceptions_ &&
+        pooled_.uses < pool_max_uses && idle.size() < pool_capacity) {
+      idle.push_back(std::move(pooled_));
+    }
+  }
+
+  context &ctx() { return *pooled_.ctx; }
+
+private:
+  struct Pooled {
+    std::unique_ptr<context> ctx;
+    size_t uses = 0;
+  };
+
+  static std::vector<Pooled> &idle_contexts() {
+    thread_local std::vector<Pooled> idle;
+    return idle;
   }
+
+  Pooled pooled_;
+  bool reuse_;
+  int exceptions_;
+};
+
+void configure_context_pool(size_t capacity, size_t max_uses) {
+  pool_capacity = capacity;
+  pool_max_uses = std::max<size_t>(max_uses, 1);
+}
+
+size_t z3_allocated() {
+  return static_cast<size_t>(Z3_get_estimated_alloc_size());
 }
 
-int main() {
+// Z3 reports hitting memory_max_size as "out of memory" (as the reason of
+// an unknown result, or as an exception from some tactics)
+bool is_memout(const std::string &message) {
+  return message.find("out of memory") != std::string::npos ||
+         message.find("memory exceeded") != std::string::npos;
+}
+
+std::atomic<size_t> default_memory_limit{0};
+
+// Largest "max_memory_mb" honoured; larger values are treated as this
+constexpr size_t MAX_MEMORY_MB = size_t(1) << 30;
+
+/**
+ * Caps Z3's allocation at ceiling_mb for the scope; 0 is no cap. Only
+ * solver checks run under it: Z3 aborts instead of failing cleanly when
+ * expression construction hits the cap. The cap is process-wide, so
+ * ceilings held at once (e.g. by checks on several threads) share it: it
+ * stays at the largest of them until the last one is released. It is
+ * exact only while one request is checked at a time, as in the daemon.
+ */
+class MemoryCeiling {
+public:
+  explicit MemoryCeiling(size_t ceiling_mb) : ceiling_mb_(ceiling_mb) {
+    if (ceiling_mb_) {
+      std::lock_guard<std::mutex> lock(mutex());
+      held().insert(ceiling_mb_);
+      apply();
+    }
+  }
+  MemoryCeiling(const MemoryCeiling &) = delete;
+  MemoryCeiling &operator=(const MemoryCeiling &) = delete;
+  ~MemoryCeiling() {
+    if (ceiling_mb_) {
+      std::lock_guard<std::mutex> lock(mutex());
+      held().erase(held().find(ceiling_mb_));
+      apply();
+    }
+  }
+
+private:
+  static std::mutex &mutex() {
+    static std::mutex m;
+    return m;
+  }
+  static std::multiset<size_t> &held() {
+    static std::multiset<size_t> ceilings;
+    return ceilings;
+  }
+  // Caller holds mutex()
+  static void apply() {
+    static size_t applied = 0;
+    size_t ceiling = held().empty() ? 0 : *held().rbegin();
+    if (ceiling != applied) {
+      set_param("memory_max_size", std::to_string(ceiling).c_str());
+      applied = ceiling;
+    }
+  }
+
+  size_t ceiling_mb_;
+};
+
+/**
+ * Prove a theorem body as its own obligation, with Z3's allocation capped
+ * at ceiling_mb (0: no cap) while it solves. Running into the cap gives
+ * "resource_exhausted".
+ */
+std::string check_theorem(const json &theorem, const VarTypes &var_types,
+                          size_t ceiling_mb) {
   try {
-    json req;
-    std::cin >> req;
+    ContextLease lease(!has_quantifier(theorem));
+    context &ctx = lease.ctx();
+    Environment env;
+    solver s(ctx);
+    for (const auto &a : theorem.at("assumptions")) {
+      s.add(formula_to_z3(a, ctx, env, var_types));
+    }
+    s.add(!formula_to_z3(theorem.at("conclusion"), ctx, env, var_types));
+
+    check_result result;
+    {
+      MemoryCeiling ceiling(ceiling_mb);
+      result = s.check();
+    }
+    if (result == unsat)
+      return "proven";
+    if (result == sat)
+      return "disproven";
+    return is_memout(s.reason_unknown()) ? "resource_exhausted" : "unknown";
+  } catch (const z3::exception &e) {
+    return is_memout(e.msg()) ? "resource_exhausted" : "error";
+  } catch (const std::exception &) {
+    // ProofError lands here
+    return "error";
+  }
+}
+
+/**
+ * Verify every theorem that is not already in the cache, in parallel with
+ * one Z3 context per thread. Z3 may allocate up to limit_mb (0: no limit)
+ * more than it holds now while solving them; the cap is process-wide, so
+ * the threads share it (see MemoryCeiling).
+ * Returns name -> {"status", "cached"}.
+ */
+json verify_theorems(const json &theorems, const VarTypes &var_types,
+                     size_t limit_mb = 0) {
+  size_t ceiling_mb = limit_mb ? (z3_allocated() + (limit_mb << 20)) >> 20 : 0;
+  struct Obligation {
+    std::string name;
+    const json *theorem;
+    uint64_t hash;
+    std::string status;
+    bool cached;
+  };
+
+  TheoremCache &cache = theorem_cache();
+  std::vector<Obligation> obligations;
+  std::vector<size_t> pending;
+  for (auto it = theorems.begin(); it != theorems.end(); ++it) {
+    if (!it->is_object() || !it->contains("assumptions") ||
+        !it->contains("conclusion")) {
+      throw FormulaError("Theorem '" + it.key() +
+                         "' missing 'assumptions' or 'conclusion' field");
+    }
+    uint64_t hash = theorem_hash(*it, var_types);
+    std::optional<std::string> status = cache.lookup(hash);
+    obligations.push_back(
+        {it.key(), &*it, hash, status.value_or(""), status.has_value()});
+    metrics().count_cache("theorem", status.has_value());
+    if (!status) {
+      pending.push_back(obligations.size() - 1);
+    }
+  }
+
+  size_t workers = std::min<size_t>(
+      std::max(1u, std::thread::hardware_concurrency()), pending.size());
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    for (size_t i; (i = next++) < pending.size();) {
+      Obligation &ob = obligations[pending[i]];
+      TraceSpan span("theorem");
+      span.arg("name", ob.name);
+      ob.status = check_theorem(*ob.theorem, var_types, ceiling_mb);
+      span.arg("status", ob.status);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < workers; ++i) {
+    threads.emplace_back([&] {
+      tracer().name_thread("theorem worker");
+      work();
+    });
+  }
+  if (workers > 0) {
+    work();
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  json results = json::object();
+  for (const auto &ob : obligations) {
+    if (!ob.cached) {
+      cache.store(ob.hash, ob.status);
+    }
+    results[ob.name] = {{"status", ob.status}, {"cached", ob.cached}};
+  }
+  return results;
+}
+
+ModelOptions ModelOptions::from_request(const json &req) {
+  ModelOptions options;
+  std::string scope = req.value("model", "full");
+  if (scope == "none") {
+    options.scope = Scope::None;
+  } else if (scope == "relevant") {
+    options.scope = Scope::Relevant;
+  } else if (scope != "full") {
+    throw ProofError("Unknown model option '" + scope +
+                     "' (expected none, relevant or full)");
+  }
+  std::string format = req.value("model_format", "exact");
+  if (format != "exact" && format != "decimal") {
+    throw ProofError("Unknown model_format '" + format +
+                     "' (expected exact or decimal)");
+  }
+  options.decimal = format == "decimal";
+  return options;
+}
 
-    json result = prove(req);
-    std::cout << result << std::endl;
+/**
+ * Format a counterexample model.
+ */
+json format_model(const model &m, const Environment &env,
+                  const ModelOptions &options,
+                  const std::set<std::string> *only) {
+  json model_out = json::object();
+  for (const auto &[name, wrapper] : env) {
+    if (only && !only->count(name)) {
+      continue;
+    }
+    expr value = m.eval(wrapper, true);
+    if (options.decimal && value.is_real() &&
+        (value.is_numeral() || value.is_algebraic())) {
+      model_out[name] = value.get_decimal_string(MODEL_DECIMAL_DIGITS);
+    } else {
+      model_out[name] = value.to_string();
+    }
+  }
+  return model_out;
+}
+
+/**
+ * Solver statistics as a JSON object, with keys in snake_case
+ * ("rlimit count" becomes "rlimit_count").
+ */
+json stats_to_json(const stats &st) {
+  json out = json::object();
+  for (unsigned i = 0; i < st.size(); ++i) {
+    std::string key = st.key(i);
+    std::replace(key.begin(), key.end(), ' ', '_');
+    std::replace(key.begin(), key.end(), '-', '_');
+    if (st.is_uint(i)) {
+      out[key] = st.uint_value(i);
+    } else {
+      out[key] = st.double_value(i);
+    }
+  }
+  return out;
+}
+
+/**
+ * Statistics of the checks between two snapshots of the same solver. Z3
+ * accumulates counters over a solver's lifetime; memory and maxima
+ * ("max_memory", "arith_max_rows", ...) are levels and are reported as
+ * they were at the second snapshot.
+ */
+json stats_since(const json &before, const json &after) {
+  json out = json::object();
+  for (auto &[key, value] : after.items()) {
+    bool level = key == "memory" || key.find("max") != std::string::npos;
+    if (level || !before.contains(key)) {
+      out[key] = value;
+    } else if (value.is_number_unsigned()) {
+      uint64_t start = before[key].get<uint64_t>();
+      uint64_t end = value.get<uint64_t>();
+      out[key] = end >= start ? end - start : end;
+    } else {
+      out[key] = value.get<double>() - before[key].get<double>();
+    }
+  }
+  return out;
+}
 
-    return result["ok"] ? 0 : 1;
+/**
+ * Approximate heap footprint of a decoded JSON value: the value itself, its
+ * strings, array storage and object tree nodes.
+ */
+size_t json_bytes(const json &j) {
+  size_t bytes = sizeof(json);
+  if (j.is_string()) {
+    bytes += sizeof(std::string) + j.get_ref<const std::string &>().capacity();
+  } else if (j.is_array()) {
+    const auto &items = j.get_ref<const json::array_t &>();
+    bytes += sizeof(json::array_t) + (items.capacity() - items.size()) * sizeof(json);
+    for (const auto &item : items) {
+      bytes += json_bytes(item);
+    }
+  } else if (j.is_object()) {
+    bytes += sizeof(json::object_t);
+    for (const auto &[key, value] : j.get_ref<const json::object_t &>()) {
+      // Red-black tree node: links and colour, then the key
+      bytes += 4 * sizeof(void *) + sizeof(std::string) + key.capacity() +
+               json_bytes(value);
+    }
+  }
+  return bytes;
+}
 
-  } catch (const json::parse_error &e) {
-    json error = {{"ok", false},
-                  {"status", "error"},
-                  {"error", std::string("Invalid JSON: ") + e.what()}};
-    std::cout << error << std::endl;
-    return 1;
+/**
+ * Content hash of a JSON term or formula (keys are sorted, so dump() is
+ * canonical).
+ */
+uint64_t json_hash(const json &j) {
+  std::string text = j.dump();
+  return content_hash(text.data(), text.size());
+}
+
+/**
+ * Result of one obligation from the previous check of a session: the
+ * dependency graph node for a step, case step, exhaustiveness check or
+ * claim.
+ */
+struct CheckRecord {
+  std::string status;
+  std::string reason;
+  json model;
+  std::set<std::string> symbols;
+  // Proven: content hashes of the facts in the unsat core
+  std::vector<uint64_t> core;
+  // Otherwise: fingerprint of every fact that was in scope
+  uint64_t context_hash = 0;
+};
+
+/**
+ * Per-document state kept between checks in --serve mode. Records are
+ * keyed by the obligation's content hash, so inserting or moving a step
+ * does not invalidate the ones around it; each check replaces the whole
+ * graph, so edits never leave stale nodes behind.
+ */
+struct Session {
+  uint64_t declarations_hash = 0;
+  std::map<uint64_t, std::vector<CheckRecord>> records;
+  std::map<uint64_t, std::vector<CheckRecord>> next_records;
+  uint64_t last_used = 0;
+};
+
+class SessionStore {
+public:
+  Session &acquire(const std::string &id) {
+    Session &session = sessions_[id];
+    session.last_used = ++clock_;
+    if (sessions_.size() > MAX_SESSIONS) {
+      auto oldest = std::min_element(
+          sessions_.begin(), sessions_.end(), [](const auto &a, const auto &b) {
+            return a.second.last_used < b.second.last_used;
+          });
+      sessions_.erase(oldest);
+    }
+    return session;
+  }
+
+private:
+  std::map<std::string, Session> sessions_;
+  uint64_t clock_ = 0;
+};
+
+SessionStore &sessions() {
+  static SessionStore store;
+  return store;
+}
+
+/**
+ * Adds the lifetime of the scope to one Timings field (if any).
+ */
+class ScopedTimer {
+public:
+  explicit ScopedTimer(int64_t *slot)
+      : slot_(slot), start_(slot ? Timings::Clock::now()
+                                 : Timings::Clock::time_point()) {}
+  ~ScopedTimer() {
+    if (slot_) {
+      *slot_ += Timings::since(start_);
+    }
+  }
+
+private:
+  int64_t *slot_;
+  Timings::Clock::time_point start_;
+};
+
+// Thrown out of a check once its request has been cancelled
+class RequestCancelled : public std::exception {
+public:
+  const char *what() const noexcept override { return "request cancelled"; }
+};
+
+// Thrown out of a check that ran into its request's memory limit
+class ResourceExhausted : public std::exception {
+public:
+  const char *what() const noexcept override { return "memory limit reached"; }
+};
+
+/**
+ * Gives solver s a time limit of timeout_ms for the scope, then puts back
+ * its configured limit (both in milliseconds, 0: none).
+ */
+class SolverTimeout {
+public:
+  SolverTimeout(solver &s, unsigned timeout_ms, unsigned configured_ms)
+      : s_(s), configured_ms_(configured_ms),
+        changed_(timeout_ms != configured_ms) {
+    if (changed_) {
+      set(timeout_ms);
+    }
+  }
+  SolverTimeout(const SolverTimeout &) = delete;
+  SolverTimeout &operator=(const SolverTimeout &) = delete;
+  ~SolverTimeout() {
+    if (changed_) {
+      set(configured_ms_);
+    }
+  }
+
+private:
+  void set(unsigned timeout_ms) {
+    params p(s_.ctx());
+    p.set("timeout", timeout_ms);
+    s_.set(p);
+  }
+
+  solver &s_;
+  unsigned configured_ms_;
+  bool changed_;
+};
+
+// Variables an unknown nonlinear obligation is split on, 3^N cases
+constexpr size_t SIGN_SPLIT_VARIABLES = 2;
+
+// Deepest cube-and-conquer split a request may ask for, 2^N cubes
+constexpr unsigned MAX_CUBE_DEPTH = 8;
+
+// How often a wait on parallel cases looks at the cancel token
+constexpr auto CANCEL_POLL_INTERVAL = std::chrono::milliseconds(20);
+
+/**
+ * Arithmetic variables that are factors of nonlinear terms (a product of
+ * non-constant factors, or a power of one) in the given formulas, most
+ * frequent first. A term shared in several places counts once.
+ */
+std::vector<expr> product_variables(const expr_vector &formulas) {
+  std::vector<std::pair<expr, size_t>> counts;
+  std::map<unsigned, size_t> index; // Variable id -> position in counts
+  std::set<unsigned> visited;
+  auto count = [&](expr factor) {
+    if (factor.is_app() && factor.decl().decl_kind() == Z3_OP_TO_REAL) {
+      factor = factor.arg(0);
+    }
+    if (!factor.is_const() || !factor.is_arith() ||
+        factor.decl().decl_kind() != Z3_OP_UNINTERPRETED) {
+      return;
+    }
+    auto [it, added] = index.emplace(factor.id(), counts.size());
+    if (added) {
+      counts.push_back({factor, 0});
+    }
+    ++counts[it->second].second;
+  };
+
+  std::vector<expr> pending;
+  for (unsigned i = 0; i < formulas.size(); ++i) {
+    pending.push_back(formulas[i]);
+  }
+  while (!pending.empty()) {
+    expr e = pending.back();
+    pending.pop_back();
+    if (!e.is_app() || !visited.insert(e.id()).second) {
+      continue;
+    }
+    Z3_decl_kind kind = e.decl().decl_kind();
+    if (kind == Z3_OP_MUL) {
+      unsigned factors = 0;
+      for (unsigned i = 0; i < e.num_args(); ++i) {
+        factors += !e.arg(i).is_numeral();
+      }
+      if (factors > 1) {
+        for (unsigned i = 0; i < e.num_args(); ++i) {
+          count(e.arg(i));
+        }
+      }
+    } else if (kind == Z3_OP_POWER && !e.arg(0).is_numeral()) {
+      count(e.arg(0));
+    }
+    for (unsigned i = 0; i < e.num_args(); ++i) {
+      pending.push_back(e.arg(i));
+    }
+  }
+
+  std::stable_sort(counts.begin(), counts.end(),
+                   [](const auto &a, const auto &b) { return a.second > b.second; });
+  std::vector<expr> ranked;
+  for (const auto &[var, n] : counts) {
+    ranked.push_back(var);
+  }
+  return ranked;
+}
+
+/**
+ * Combined result of checking the same assertions under several case
+ * constraints: sat if any case is sat, unsat if every case is unsat, and
+ * unknown otherwise.
+ */
+struct CaseSplitResult {
+  check_result result = unknown;
+  std::string reason; // Of the first unknown case
+  std::optional<model> witness; // Of the first sat case, in the caller's context
+  std::vector<std::string> core; // Union of the cases' unsat cores, by name
+  size_t cases = 0;
+};
+
+/**
+ * Check assertions, with assumptions as for solver::check, under each of
+ * the case constraints. The cases are spread over worker threads, each
+ * with its own context holding a translated copy of the assertions, and
+ * share a timeout of timeout_ms (0: none) from the call. Once a case is
+ * sat or the request is cancelled, the workers are interrupted.
+ */
+CaseSplitResult check_cases(const expr_vector &assertions,
+                            const expr_vector &assumptions,
+                            const std::vector<expr> &cases,
+                            unsigned timeout_ms, const CancelToken *cancel) {
+  struct Worker {
+    std::unique_ptr<context> ctx;
+    bool running = false;
+  };
+  struct Case {
+    check_result result = unknown;
+    std::string reason = "canceled";
+    std::optional<model> witness; // In the worker's context
+    std::vector<std::string> core;
+  };
+
+  expr_vector constraints(assertions.ctx());
+  for (const expr &c : cases) {
+    constraints.push_back(c);
+  }
+  // Declared before outcomes, whose models live in the workers' contexts
+  std::vector<Worker> workers(std::min<size_t>(
+      std::max(1u, std::thread::hardware_concurrency()), cases.size()));
+  std::vector<Case> outcomes(cases.size());
+  Timings::Clock::time_point deadline =
+      Timings::Clock::now() + std::chrono::milliseconds(timeout_ms);
+  // Guards stop, the running flags and every use of the caller's context
+  std::mutex mutex;
+  std::condition_variable progress;
+  size_t finished = 0;
+  bool stop = false;
+  auto interrupt = [&] { // With mutex held
+    stop = true;
+    for (Worker &w : workers) {
+      if (w.running) {
+        w.ctx->interrupt();
+      }
+    }
+  };
+
+  std::atomic<size_t> next{0};
+  auto work = [&](Worker &w) {
+    w.ctx = std::make_unique<context>();
+    std::optional<solver> s;
+    std::optional<expr_vector> local_assumptions, local_constraints;
+    for (size_t i; (i = next++) < cases.size();) {
+      Case &c = outcomes[i];
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        w.running = !stop;
+        if (w.running && !s) {
+          s.emplace(*w.ctx);
+          expr_vector translated(*w.ctx, assertions);
+          for (unsigned j = 0; j < translated.size(); ++j) {
+            s->add(translated[j]);
+          }
+          local_assumptions.emplace(*w.ctx, assumptions);
+          local_constraints.emplace(*w.ctx, constraints);
+        }
+      }
+      if (w.running) {
+        TraceSpan span("case_check");
+        span.arg("case", i + 1);
+        s->push();
+        try {
+          s->add((*local_constraints)[static_cast<unsigned>(i)]);
+          if (timeout_ms) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - Timings::Clock::now());
+            params p(*w.ctx);
+            p.set("timeout", static_cast<unsigned>(std::max<int64_t>(left.count(), 1)));
+            s->set(p);
+          }
+          c.result = s->check(*local_assumptions);
+          c.reason.clear();
+          // Z3 gives various reasons for running out of time
+          bool expired = timeout_ms && Timings::Clock::now() >= deadline;
+          if (c.result == sat) {
+            c.witness = s->get_model();
+          } else if (c.result == unsat) {
+            expr_vector core = s->unsat_core();
+            for (unsigned j = 0; j < core.size(); ++j) {
+              c.core.push_back(core[j].decl().name().str());
+            }
+          } else {
+            c.reason = expired ? "timeout" : s->reason_unknown();
+          }
+        } catch (const z3::exception &e) {
+          c.result = unknown;
+          c.reason = e.msg();
+        }
+        s->pop();
+        span.arg("status", c.result == unsat ? "unsat"
+                           : c.result == sat ? "sat"
+                                             : "unknown");
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      w.running = false;
+      ++finished;
+      if (c.result == sat && !stop) {
+        interrupt();
+      }
+      progress.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (Worker &w : workers) {
+    threads.emplace_back([&] {
+      tracer().name_thread("case worker");
+      work(w);
+    });
+  }
+  {
+    // This thread only watches for cancellation
+    std::unique_lock<std::mutex> lock(mutex);
+    while (finished < cases.size()) {
+      if (!stop && cancel && cancel->cancelled()) {
+        interrupt();
+      }
+      progress.wait_for(lock, CANCEL_POLL_INTERVAL);
+    }
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  CaseSplitResult combined;
+  combined.cases = cases.size();
+  combined.result = unsat;
+  std::set<std::string> in_core;
+  for (Case &c : outcomes) {
+    if (c.result == sat) {
+      combined.result = sat;
+      combined.witness.emplace(*c.witness, assertions.ctx(), model::translate());
+      break;
+    }
+    if (c.result == unknown && combined.result == unsat) {
+      combined.result = unknown;
+      combined.reason = c.reason;
+    }
+    for (const std::string &name : c.core) {
+      if (in_core.insert(name).second) {
+        combined.core.push_back(name);
+      }
+    }
+  }
+  return combined;
+}
+
+/**
+ * Checks every obligation of one proof against a single solver:
+ * assumptions and proven steps are asserted once, and each obligation is
+ * checked in its own push/pop scope with the premises most relevant to it.
+ *
+ * With a session, every fact is guarded by an indicator literal so the
+ * unsat core of a proven obligation names the facts it depends on. An
+ * obligation is then skipped when its previous result still holds: a proof
+ * whose core facts are all still in scope, or any other result whose whole
+ * context is unchanged.
+ */
+class ProofChecker {
+public:
+  struct Outcome {
+    std::string status;
+    std::string reason; // Z3's reason when status is "unknown"
+    json model;
+    json stats; // Solver statistics of this check, if collected
+    json depends_on = json::array();
+    bool cached = false;
+  };
+
+  ProofChecker(context &ctx, Environment &env, const VarTypes &var_types,
+               const json &premises, size_t premise_limit, Session *session,
+               const CancelToken *cancel = nullptr, Timings *timings = nullptr)
+      : ctx_(ctx), env_(env), var_types_(var_types), premises_(premises),
+        premise_limit_(premise_limit), session_(session), cancel_(cancel),
+        timings_(timings), s_(ctx) {
+    for (const auto &p : premises_) {
+      premise_hashes_.push_back(json_hash(p["formula"]));
+    }
+  }
+
+  // Z3 gives up on each check after this many milliseconds
+  void set_timeout(unsigned milliseconds) {
+    params p(ctx_);
+    p.set("timeout", milliseconds);
+    s_.set(p);
+    timeout_ms_ = milliseconds;
+  }
+
+  // Retry unknown nonlinear obligations case by case (see split_on_signs)
+  void set_sign_split(bool enabled) { sign_split_ = enabled; }
+
+  // Solve each obligation as up to 2^depth cubes (0: one check; see
+  // cube_and_conquer)
+  void set_cube_depth(unsigned depth) {
+    cube_depth_ = depth;
+    if (depth) {
+      params p(ctx_);
+      p.set("cube_depth", depth);
+      s_.set(p);
+    }
+  }
+
+  // Attach solver statistics to every outcome that was solved (not reused)
+  void collect_stats(bool enabled) { collect_stats_ = enabled; }
+
+  // Record Z3's peak allocation growth after translating and after solving
+  void track_memory(MemoryUsage *memory) { memory_ = memory; }
+
+  // Which variables counterexamples list, and how their values are written
+  void set_model_options(const ModelOptions &options) {
+    model_options_ = options;
+  }
+
+  // Fail with ResourceExhausted once Z3 allocates limit_mb more than now
+  void limit_memory(size_t limit_mb) {
+    memory_base_ = z3_allocated();
+    memory_limit_ = limit_mb << 20;
+  }
+
+  void assume(const json &formula, const std::string &label) {
+    expr f = translate(formula);
+    Fact fact{json_hash(formula), label, std::nullopt};
+    if (session_) {
+      expr indicator = ctx_.bool_const(("fact!" + std::to_string(next_indicator_++)).c_str());
+      s_.add(implies(indicator, f));
+      fact.indicator = indicator;
+    } else {
+      s_.add(f);
+    }
+    facts_.push_back(fact);
+  }
+
+  void push() {
+    s_.push();
+    scopes_.push_back(facts_.size());
+  }
+
+  void pop() {
+    s_.pop();
+    facts_.resize(scopes_.back());
+    scopes_.pop_back();
+  }
+
+  Outcome check(const json &goal) {
+    uint64_t goal_hash = json_hash(goal);
+    if (session_) {
+      std::optional<Outcome> hit = reuse(goal_hash);
+      metrics().count_cache("session", hit.has_value());
+      if (hit) {
+        return *hit;
+      }
+    }
+
+    Outcome outcome = solve(goal);
+
+    // Running out of time says nothing about the next check, which may
+    // have longer
+    bool out_of_time = outcome.status == "unknown" &&
+                       (outcome.reason == "timeout" || outcome.reason == "canceled");
+    if (session_ && !out_of_time) {
+      CheckRecord record;
+      record.status = outcome.status;
+      record.reason = outcome.reason;
+      record.model = outcome.model;
+      collect_symbols(goal, record.symbols);
+      record.context_hash = context_hash();
+      record.core = last_core_;
+      session_->next_records[goal_hash].push_back(record);
+    }
+    return outcome;
+  }
+
+private:
+  struct Fact {
+    uint64_t hash;
+    std::string label;
+    std::optional<expr> indicator;
+  };
+
+  uint64_t context_hash() const {
+    json hashes = json::array();
+    for (const auto &fact : facts_) {
+      hashes.push_back(fact.hash);
+    }
+    for (uint64_t h : premise_hashes_) {
+      hashes.push_back(h);
+    }
+    return json_hash(hashes);
+  }
+
+  // Label of an in-scope fact or premise with the given content hash
+  std::optional<std::string> label_for(uint64_t hash) const {
+    for (const auto &fact : facts_) {
+      if (fact.hash == hash) {
+        return fact.label;
+      }
+    }
+    for (size_t i = 0; i < premise_hashes_.size(); ++i) {
+      if (premise_hashes_[i] == hash) {
+        return "premise " + premises_[i].value("name", std::to_string(i + 1));
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<Outcome> reuse(uint64_t goal_hash) {
+    auto it = session_->records.find(goal_hash);
+    if (it == session_->records.end()) {
+      return std::nullopt;
+    }
+    for (const CheckRecord &record : it->second) {
+      if (std::optional<Outcome> outcome = still_valid(record)) {
+        session_->next_records[goal_hash].push_back(record);
+        return outcome;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<Outcome> still_valid(const CheckRecord &record) const {
+    Outcome outcome;
+    outcome.status = record.status;
+    outcome.reason = record.reason;
+    outcome.model = record.model;
+    outcome.cached = true;
+    if (record.status == "proven") {
+      // Still proven as long as every fact of its core is in scope
+      for (uint64_t h : record.core) {
+        std::optional<std::string> label = label_for(h);
+        if (!label) {
+          return std::nullopt;
+        }
+        outcome.depends_on.push_back(*label);
+      }
+    } else if (record.context_hash != context_hash()) {
+      return std::nullopt;
+    }
+    return outcome;
+  }
+
+  /**
+   * Only the top premise_limit premises are asserted at first; on sat or
+   * unknown the selection is doubled until every premise is in.
+   */
+  Outcome solve(const json &goal) {
+    std::vector<const json *> ranked = rank_premises(premises_, goal);
+    size_t k = std::min(premise_limit_, ranked.size());
+    expr goal_z3 = translate(goal);
+    last_core_.clear();
+    json stats_before =
+        collect_stats_ ? stats_to_json(s_.statistics()) : json();
+
+    while (true) {
+      s_.push();
+      expr_vector indicators(ctx_);
+      std::map<std::string, uint64_t> hash_of;
+      for (const auto &fact : facts_) {
+        if (fact.indicator) {
+          indicators.push_back(*fact.indicator);
+          hash_of[fact.indicator->decl().name().str()] = fact.hash;
+        }
+      }
+      for (size_t i = 0; i < k; ++i) {
+        expr p = translate((*ranked[i])["formula"]);
+        if (session_) {
+          expr indicator = ctx_.bool_const(("premise!" + std::to_string(i)).c_str());
+          s_.add(implies(indicator, p));
+          indicators.push_back(indicator);
+          hash_of[indicator.decl().name().str()] =
+              json_hash((*ranked[i])["formula"]);
+        } else {
+          s_.add(p);
+        }
+      }
+      s_.add(!goal_z3);
+
+      throw_if_cancelled();
+      // Under a time limit, a goal that could be split on signs keeps
+      // half of the limit for the split
+      unsigned check_ms = timeout_ms_;
+      if (timeout_ms_ && sign_split_ &&
+          !product_variables(s_.assertions()).empty()) {
+        check_ms = std::max(timeout_ms_ / 2, 1u);
+      }
+      Timings::Clock::time_point check_start = Timings::Clock::now();
+      check_result result;
+      // Set when the check was split into cubes
+      std::optional<CaseSplitResult> conquered;
+      {
+        ScopedTimer timer(timings_ ? &timings_->solve : nullptr);
+        TraceSpan span("solve");
+        span.arg("premises", k);
+        MemoryCeiling ceiling(
+            memory_limit_ ? (memory_base_ + memory_limit_) >> 20 : 0);
+        SolverTimeout limit(s_, check_ms, timeout_ms_);
+        if (cube_depth_) {
+          conquered = cube_and_conquer(indicators, check_ms);
+        }
+        result = conquered ? conquered->result
+                 : session_ ? s_.check(indicators)
+                            : s_.check();
+      }
+      if (memory_) {
+        sample_memory(memory_->z3_solve);
+      }
+      // An interrupted check comes back as unknown
+      throw_if_cancelled();
+      if (result == unsat || k >= ranked.size()) {
+        Outcome outcome;
+        if (result == unsat) {
+          outcome.status = "proven";
+          if (session_) {
+            std::vector<std::string> core;
+            if (conquered) {
+              core = conquered->core;
+            } else {
+              expr_vector literals = s_.unsat_core();
+              for (unsigned i = 0; i < literals.size(); ++i) {
+                core.push_back(literals[i].decl().name().str());
+              }
+            }
+            for (const std::string &name : core) {
+              uint64_t h = hash_of.at(name);
+              last_core_.push_back(h);
+              outcome.depends_on.push_back(*label_for(h));
+            }
+          }
+        } else if (result == sat) {
+          outcome.status = "disproven";
+          outcome.model = counterexample(
+              conquered ? *conquered->witness : s_.get_model(), goal);
+        } else {
+          outcome.status = "unknown";
+          outcome.reason =
+              conquered ? conquered->reason : s_.reason_unknown();
+          if (is_memout(outcome.reason)) {
+            throw ResourceExhausted();
+          }
+        }
+        size_t split_cases = 0;
+        if (outcome.status == "unknown" && sign_split_) {
+          // The split gets what is left of the time limit, and at least
+          // the part reserved for it: Z3 does not always stop on time
+          int64_t split_ms = 0;
+          if (timeout_ms_) {
+            split_ms = std::max<int64_t>(
+                timeout_ms_ - Timings::since(check_start) / 1000,
+                timeout_ms_ - check_ms);
+          }
+          if (!timeout_ms_ || split_ms > 0) {
+            split_cases = split_on_signs(goal, indicators, hash_of, outcome,
+                                         static_cast<unsigned>(split_ms));
+          }
+        }
+        if (collect_stats_) {
+          // Covers every attempt with a widened premise selection
+          outcome.stats =
+              stats_since(stats_before, stats_to_json(s_.statistics()));
+          if (split_cases) {
+            outcome.stats["sign_split_cases"] = split_cases;
+          }
+          if (conquered) {
+            outcome.stats["cubes"] = conquered->cases;
+          }
+        }
+        s_.pop();
+        return outcome;
+      }
+      s_.pop();
+      k = std::min(std::max<size_t>(2 * k, 1), ranked.size());
+    }
+  }
+
+  // The model of a disproven goal, as the request's model options ask
+  json counterexample(const model &m, const json &goal) {
+    if (model_options_.scope == ModelOptions::Scope::None) {
+      return json();
+    }
+    ScopedTimer timer(timings_ ? &timings_->model : nullptr);
+    TraceSpan span("model");
+    std::set<std::string> relevant;
+    if (model_options_.scope == ModelOptions::Scope::Relevant) {
+      collect_symbols(goal, relevant);
+    }
+    return format_model(m, env_, model_options_,
+                        model_options_.scope == ModelOptions::Scope::Relevant
+                            ? &relevant
+                            : nullptr);
+  }
+
+  /**
+   * Check the obligation in the solver's current scope by cube and
+   * conquer: Z3's lookahead cuber picks the literals that best split the
+   * search, down to cube_depth_ levels, and the cubes are solved in
+   * parallel. Returns nothing when the lookahead finds fewer than two
+   * cubes (a goal with no Boolean structure to split on, or one refuted
+   * by propagation), which are left to a single check.
+   */
+  std::optional<CaseSplitResult> cube_and_conquer(const expr_vector &indicators,
+                                                  unsigned timeout_ms) {
+    std::vector<expr> cubes;
+    {
+      TraceSpan span("cube");
+      try {
+        // The cuber keeps its state in the solver until it is exhausted,
+        // so every cube is fetched
+        for (const expr_vector &cube : s_.cubes()) {
+          cubes.push_back(mk_and(cube));
+        }
+      } catch (const z3::exception &) {
+        throw_if_cancelled();
+        throw;
+      }
+      span.arg("cubes", cubes.size());
+    }
+    if (cubes.size() < 2) {
+      return std::nullopt;
+    }
+    return check_cases(s_.assertions(), indicators, cubes, timeout_ms,
+                       cancel_);
+  }
+
+  /**
+   * Retry an unknown obligation, with the solver still holding its scope,
+   * as one case per sign (< 0, = 0, > 0) of each of the
+   * SIGN_SPLIT_VARIABLES variables that occur most often in products, as
+   * a manual cases: step would. With the signs fixed, nonlinear terms are
+   * often within reach of the solver. The cases are checked in parallel
+   * and share timeout_ms (0: none). Updates outcome unless some case is
+   * still unknown, and returns the number of cases (0 with no product to
+   * split on).
+   */
+  size_t split_on_signs(const json &goal, const expr_vector &indicators,
+                        const std::map<std::string, uint64_t> &hash_of,
+                        Outcome &outcome, unsigned timeout_ms) {
+    expr_vector assertions = s_.assertions();
+    std::vector<expr> vars = product_variables(assertions);
+    if (vars.empty()) {
+      return 0;
+    }
+    if (vars.size() > SIGN_SPLIT_VARIABLES) {
+      vars.erase(vars.begin() + SIGN_SPLIT_VARIABLES, vars.end());
+    }
+    std::vector<expr> cases{ctx_.bool_val(true)};
+    for (const expr &v : vars) {
+      std::vector<expr> refined;
+      for (const expr &c : cases) {
+        refined.push_back(c && v < 0);
+        refined.push_back(c && v == 0);
+        refined.push_back(c && v > 0);
+      }
+      cases = std::move(refined);
+    }
+
+    CaseSplitResult split;
+    {
+      ScopedTimer timer(timings_ ? &timings_->solve : nullptr);
+      TraceSpan span("sign_split");
+      span.arg("cases", cases.size());
+      MemoryCeiling ceiling(
+          memory_limit_ ? (memory_base_ + memory_limit_) >> 20 : 0);
+      split = check_cases(assertions, indicators, cases, timeout_ms, cancel_);
+    }
+    throw_if_cancelled();
+    if (split.result == unsat) {
+      outcome.status = "proven";
+      outcome.reason.clear();
+      for (const std::string &name : split.core) {
+        uint64_t h = hash_of.at(name);
+        last_core_.push_back(h);
+        outcome.depends_on.push_back(*label_for(h));
+      }
+    } else if (split.result == sat) {
+      outcome.status = "disproven";
+      outcome.reason.clear();
+      outcome.model = counterexample(*split.witness, goal);
+    } else if (is_memout(split.reason)) {
+      throw ResourceExhausted();
+    } else {
+      outcome.reason = split.reason;
+    }
+    return split.cases;
+  }
+
+  expr translate(const json &formula) {
+    ScopedTimer timer(timings_ ? &timings_->translate : nullptr);
+    TraceSpan span("translate");
+    expr e = formula_to_z3(formula, ctx_, env_, var_types_);
+    if (memory_) {
+      sample_memory(memory_->z3_translate);
+    }
+    if (memory_limit_ && z3_allocated() > memory_base_ + memory_limit_) {
+      throw ResourceExhausted();
+    }
+    return e;
+  }
+
+  // Raise peak to Z3's current allocation growth over the request's start
+  void sample_memory(size_t &peak) const {
+    size_t now = z3_allocated();
+    if (now > memory_->z3_start) {
+      peak = std::max(peak, now - memory_->z3_start);
+    }
+  }
+
+  void throw_if_cancelled() const {
+    if (cancel_ && cancel_->cancelled()) {
+      throw RequestCancelled();
+    }
+  }
+
+  context &ctx_;
+  Environment &env_;
+  const VarTypes &var_types_;
+  const json &premises_;
+  size_t premise_limit_;
+  Session *session_;
+  const CancelToken *cancel_;
+  Timings *timings_;
+  bool collect_stats_ = false;
+  MemoryUsage *memory_ = nullptr;
+  ModelOptions model_options_;
+  unsigned timeout_ms_ = 0;
+  bool sign_split_ = true;
+  unsigned cube_depth_ = 0;
+  size_t memory_base_ = 0;
+  size_t memory_limit_ = 0;
+  solver s_;
+  std::vector<Fact> facts_;
+  std::vector<size_t> scopes_;
+  std::vector<uint64_t> premise_hashes_;
+  std::vector<uint64_t> last_core_;
+  size_t next_indicator_ = 0;
+};
+
+/**
+ * JSON result of a step check, in the format of python/prover.py.
+ */
+json step_result(size_t step, const ProofChecker::Outcome &outcome,
+                 bool tracked) {
+  json result = {{"step", step},
+                 {"ok", outcome.status == "proven"},
+                 {"status", outcome.status}};
+  if (outcome.status == "disproven") {
+    if (!outcome.model.is_null()) {
+      result["model"] = outcome.model;
+    }
+  } else if (outcome.status == "unknown") {
+    result["reason"] = outcome.reason;
+  }
+  if (!outcome.stats.is_null()) {
+    result["stats"] = outcome.stats;
+  }
+  if (tracked) {
+    result["cached"] = outcome.cached;
+    if (outcome.status == "proven") {
+      result["depends_on"] = outcome.depends_on;
+    }
+  }
+  return result;
+}
+
+/**
+ * Check intermediate steps in order; each proven step becomes a fact for
+ * the ones after it. A cases step checks each case's steps under its
+ * condition and then that the conditions are exhaustive.
+ */
+json check_steps(ProofChecker &checker, const json &steps, bool tracked,
+                 const StepCallback &on_step, Timings *timings = nullptr) {
+  json step_results = json::array();
+  TraceSpan *step_span = nullptr;
+  auto record = [&](json result) {
+    step_span->arg("status", result.value("status", "error"));
+    if (on_step) {
+      on_step(result);
+    }
+    step_results.push_back(std::move(result));
+  };
+  // Appends a step's solver time to timings->steps on every exit path
+  struct StepTiming {
+    Timings *timings;
+    int64_t start;
+    ~StepTiming() {
+      if (timings) {
+        timings->steps.push_back(timings->solve - start);
+      }
+    }
+  };
+  size_t index = 0;
+  for (const auto &step : steps) {
+    ++index;
+    StepTiming step_timing{timings, timings ? timings->solve : 0};
+    TraceSpan span("step");
+    span.arg("step", index);
+    step_span = &span;
+    if (step.value("type", "") == "cases") {
+      json case_results = json::array();
+      json conditions = json::array();
+      size_t case_index = 0;
+      for (const auto &c : step.value("cases", json::array())) {
+        ++case_index;
+        if (!c.contains("condition")) {
+          throw FormulaError("Case missing 'condition' field");
+        }
+        conditions.push_back(c["condition"]);
+
+        TraceSpan case_span("case");
+        case_span.arg("case", case_index);
+        checker.push();
+        checker.assume(c["condition"], "case " + std::to_string(case_index));
+        json case_steps = json::array();
+        bool case_ok = true;
+        size_t case_step = 0;
+        for (const auto &cs : c.value("steps", json::array())) {
+          ++case_step;
+          if (!cs.contains("formula")) {
+            continue;
+          }
+          TraceSpan case_step_span("step");
+          case_step_span.arg("step", std::to_string(index) + "." +
+                                         std::to_string(case_index) + "." +
+                                         std::to_string(case_step));
+          ProofChecker::Outcome outcome = checker.check(cs["formula"]);
+          case_step_span.arg("status", outcome.status);
+          if (outcome.status == "proven") {
+            checker.assume(cs["formula"], "step " + std::to_string(index) +
+                                              "." +
+                                              std::to_string(case_index) +
+                                              "." + std::to_string(case_step));
+          } else {
+            case_ok = false;
+          }
+          case_steps.push_back(step_result(case_step, outcome, tracked));
+        }
+        checker.pop();
+        case_span.arg("ok", case_ok);
+
+        case_results.push_back({{"case", case_index},
+                                {"ok", case_ok},
+                                {"step_results", case_steps}});
+      }
+
+      if (conditions.empty()) {
+        continue;
+      }
+      ProofChecker::Outcome exhaustive;
+      {
+        TraceSpan exhaustive_span("exhaustiveness");
+        exhaustive = checker.check({{"type", "or"}, {"args", conditions}});
+        exhaustive_span.arg("status", exhaustive.status);
+      }
+      json result;
+      if (exhaustive.status != "proven") {
+        result = {{"step", index},
+                  {"type", "cases"},
+                  {"ok", false},
+                  {"status", "non-exhaustive"},
+                  {"message", "Cases may not cover all possibilities"}};
+      } else {
+        result = {{"step", index},
+                  {"type", "cases"},
+                  {"ok", true},
+                  {"status", "proven"},
+                  {"case_results", case_results}};
+      }
+      // Statistics of the exhaustiveness check; each case step has its own
+      if (!exhaustive.stats.is_null()) {
+        result["stats"] = exhaustive.stats;
+      }
+      record(std::move(result));
+      continue;
+    }
+
+    if (!step.contains("formula")) {
+      record({{"step", index}, {"ok", false}, {"error", "Step missing formula"}});
+      continue;
+    }
+    ProofChecker::Outcome outcome = checker.check(step["formula"]);
+    if (outcome.status == "proven") {
+      // Proven steps are available to every later step and the claim
+      checker.assume(step["formula"], "step " + std::to_string(index));
+    }
+    record(step_result(index, outcome, tracked));
+  }
+  return step_results;
+}
+
+json cancelled_response() {
+  return {{"ok", false},
+          {"status", "cancelled"},
+          {"message", "Check cancelled before it finished"}};
+}
+
+void set_memory_limit(size_t megabytes) {
+  default_memory_limit = std::min(megabytes, MAX_MEMORY_MB);
+}
+
+void preload_library(const std::string &artifact_path) {
+  Library lib = load_library(artifact_path);
+  seed_theorem_cache(lib);
+  // Theorems the artifact does not record as proven, under their own types
+  std::map<VarTypes, json> by_types;
+  for (auto &[name, theorem] : lib.theorems.items()) {
+    by_types[theorem.value("var_types", json::object()).get<VarTypes>()][name] =
+        theorem;
+  }
+  for (const auto &[types, theorems] : by_types) {
+    verify_theorems(theorems, types, default_memory_limit);
+  }
+  preloaded_libraries()[artifact_path] = std::move(lib);
+}
+
+void warm_up() {
+  // x*x >= 0 over the reals and n*n >= n over the integers: nonlinear
+  // arithmetic in both theories
+  json square = {{"type", "bin"},
+                 {"op", "*"},
+                 {"lhs", {{"type", "var"}, {"name", "x"}}},
+                 {"rhs", {{"type", "var"}, {"name", "x"}}}};
+  json int_square = {{"type", "bin"},
+                     {"op", "*"},
+                     {"lhs", {{"type", "var"}, {"name", "n"}}},
+                     {"rhs", {{"type", "var"}, {"name", "n"}}}};
+  json claim = {{"type", "and"},
+                {"args",
+                 {{{"type", "rel"},
+                   {"op", ">="},
+                   {"lhs", square},
+                   {"rhs", {{"type", "num"}, {"value", "0"}}}},
+                  {{"type", "rel"},
+                   {"op", ">="},
+                   {"lhs", int_square},
+                   {"rhs", {{"type", "var"}, {"name", "n"}}}}}}};
+  prove({{"vars", {"x", "n"}},
+         {"var_types", {{"n", "Int"}}},
+         {"claim", claim}});
+}
+
+json resource_exhausted_response(size_t limit_mb) {
+  return {{"ok", false},
+          {"status", "resource_exhausted"},
+          {"message", "Check exceeded its memory limit of " +
+                          std::to_string(limit_mb) + " MB"}};
+}
+
+json prove(const json &req, const StepCallback &on_step, CancelToken *cancel,
+           Timings *timings, MemoryUsage *memory) {
+  Timings local_timings;
+  if (!timings) {
+    timings = &local_timings;
+  }
+  MemoryUsage local_memory;
+  bool report_memory = req.is_object() && req.value("memory", false);
+  if (!memory && report_memory) {
+    memory = &local_memory;
+  }
+  if (memory) {
+    memory->ast = json_bytes(req);
+    memory->z3_start = z3_allocated();
+  }
+  Timings::Clock::time_point validate_start = Timings::Clock::now();
+  std::optional<TraceSpan> validate_span(std::in_place, "validate");
+  size_t limit_mb = default_memory_limit;
+  try {
+    if (req.is_object() && req.contains("max_memory_mb")) {
+      const json &value = req["max_memory_mb"];
+      if (!value.is_number_unsigned()) {
+        throw ProofError("max_memory_mb must be a non-negative integer");
+      }
+      limit_mb = std::min(value.get<size_t>(), MAX_MEMORY_MB);
+    }
+    // The decoded request is our own share of the budget
+    if (limit_mb && (memory ? memory->ast : json_bytes(req)) > limit_mb << 20) {
+      throw ResourceExhausted();
+    }
+    ContextLease lease(!has_quantifier(req));
+    context &ctx = lease.ctx();
+    // Detach before ctx is released
+    struct Attachment {
+      CancelToken *token;
+      Attachment(CancelToken *t, context *c) : token(t) {
+        if (token) {
+          token->attach(c);
+        }
+      }
+      ~Attachment() {
+        if (token) {
+          token->attach(nullptr);
+        }
+      }
+    } attachment(cancel, &ctx);
+    Environment env;
+    VarTypes var_types;
+
+    // Parse variable types
+    if (req.contains("var_types") && req["var_types"].is_object()) {
+      for (auto &[name, type_val] : req["var_types"].items()) {
+        var_types[name] = type_val.get<std::string>();
+      }
+    }
+
+    // Initialize declared variables
+    if (req.contains("vars")) {
+      for (const auto &name_json : req["vars"]) {
+        std::string n = name_json.get<std::string>();
+        if (var_types.count(n) && var_types[n] == "Int") {
+          env[n] = ExprWrapper(ctx.int_const(n.c_str()));
+        } else {
+          env[n] = ExprWrapper(ctx.real_const(n.c_str()));
+        }
+      }
+    }
+
+    // Get the claim
+    if (!req.contains("claim")) {
+      return {{"ok", false},
+              {"status", "error"},
+              {"error", "Missing 'claim' field"}};
+    }
+
+    // Theorems from precompiled libraries can be applied by name. Their
+    // compile-time verification status seeds the theorem cache.
+    json library_theorems = json::object();
+    if (req.contains("libraries")) {
+      for (const auto &path : req["libraries"]) {
+        std::optional<Library> loaded;
+        const Library *lib = preloaded_library(path.get<std::string>());
+        if (!lib) {
+          loaded = load_library(path.get<std::string>());
+          lib = &*loaded;
+        }
+        seed_theorem_cache(*lib);
+        library_theorems.update(lib->theorems);
+      }
+    }
+
+    json premises = resolve_premises(req.value("premises", json::array()),
+                                     library_theorems);
+
+    // Verify every theorem body before any of them is trusted
+    json theorems = library_theorems;
+    theorems.update(req.value("theorems", json::object()));
+    timings->validate = Timings::since(validate_start);
+    validate_span.reset();
+    json theorem_results;
+    {
+      ScopedTimer timer(&timings->theorems);
+      TraceSpan span("theorems");
+      theorem_results = verify_theorems(theorems, var_types, limit_mb);
+    }
+    for (const auto &[name, result] : theorem_results.items()) {
+      if (result["status"] == "resource_exhausted") {
+        throw ResourceExhausted();
+      }
+    }
+
+    for (const auto &p : premises) {
+      std::string name = p.value("name", "");
+      auto it = theorem_results.find(name);
+      if (it != theorem_results.end() && (*it)["status"] != "proven") {
+        return {{"ok", false},
+                {"status", "error"},
+                {"error", "Theorem '" + name + "' could not be verified (" +
+                              (*it)["status"].get<std::string>() + ")"},
+                {"theorem_results", theorem_results}};
+      }
+    }
+
+    size_t premise_limit =
+        req.value("premise_limit", DEFAULT_PREMISE_LIMIT);
+    ModelOptions model_options = ModelOptions::from_request(req);
+    std::optional<unsigned> timeout_ms;
+    if (req.contains("timeout_ms")) {
+      const json &value = req["timeout_ms"];
+      if (!value.is_number_unsigned() ||
+          value.get<uint64_t>() > std::numeric_limits<unsigned>::max()) {
+        throw ProofError("timeout_ms must be a non-negative integer of at most " +
+                         std::to_string(std::numeric_limits<unsigned>::max()));
+      }
+      timeout_ms = value.get<unsigned>();
+    }
+    unsigned cube_depth = 0;
+    if (req.contains("cube_depth")) {
+      const json &value = req["cube_depth"];
+      if (!value.is_number_unsigned() || value.get<uint64_t>() > MAX_CUBE_DEPTH) {
+        throw ProofError("cube_depth must be an integer from 0 to " +
+                         std::to_string(MAX_CUBE_DEPTH));
+      }
+      cube_depth = value.get<unsigned>();
+    }
+
+    // A session keeps the dependency graph of the previous check so that
+    // only obligations whose dependencies changed are re-solved
+    Session *session = nullptr;
+    if (req.contains("session")) {
+      session = &sessions().acquire(req["session"].get<std::string>());
+      std::set<std::string> declared;
+      for (const auto &v : req.value("vars", json::array())) {
+        declared.insert(v.get<std::string>());
+      }
+      // Recorded counterexamples are only reused in the same format, and
+      // unknown results only with the same time limit and splitting (Z3
+      // does not always give "timeout" as the reason)
+      uint64_t declarations =
+          json_hash({declared, req.value("var_types", json::object()),
+                     req.value("model", "full"),
+                     req.value("model_format", "exact"),
+                     req.value("timeout_ms", json()),
+                     req.value("sign_split", true),
+                     cube_depth});
+      if (session->declarations_hash != declarations) {
+        session->records.clear();
+        session->declarations_hash = declarations;
+      }
+      session->next_records.clear();
+    }
+
+    ProofChecker checker(ctx, env, var_types, premises, premise_limit,
+                         session, cancel, timings);
+    if (timeout_ms) {
+      checker.set_timeout(*timeout_ms);
+    }
+    checker.collect_stats(req.value("stats", false));
+    checker.set_model_options(model_options);
+    checker.set_sign_split(req.value("sign_split", true));
+    checker.set_cube_depth(cube_depth);
+    checker.track_memory(memory);
+    checker.limit_memory(limit_mb);
+
+    // Add assumptions
+    if (req.contains("assumptions")) {
+      size_t index = 0;
+      for (const auto &a : req["assumptions"]) {
+        checker.assume(a, "assumption " + std::to_string(++index));
+      }
+    }
+
+    json step_results =
+        check_steps(checker, req.value("steps", json::array()),
+                    session != nullptr, on_step, timings);
+
+    // Prove: assumptions => claim
+    // Check UNSAT of: assumptions AND (NOT claim)
+    int64_t claim_start = timings->solve;
+    ProofChecker::Outcome outcome;
+    {
+      TraceSpan span("claim");
+      outcome = checker.check(req["claim"]);
+      span.arg("status", outcome.status);
+    }
+    timings->claim = timings->solve - claim_start;
+
+    json response;
+    if (outcome.status == "proven") {
+      response = {{"ok", true}, {"status", "proven"}};
+    } else if (outcome.status == "disproven") {
+      response = {{"ok", false}, {"status", "disproven"}};
+      if (!outcome.model.is_null()) {
+        response["model"] = outcome.model;
+      }
+    } else {
+      response = {{"ok", false},
+                  {"status", "unknown"},
+                  {"reason", outcome.reason},
+                  {"message", "Z3 could not determine satisfiability"}};
+    }
+
+    if (!step_results.empty()) {
+      response["step_results"] = step_results;
+    }
+    if (!outcome.stats.is_null()) {
+      response["stats"] = outcome.stats;
+    }
+    if (session) {
+      response["cached"] = outcome.cached;
+      if (outcome.status == "proven") {
+        response["depends_on"] = outcome.depends_on;
+      }
+      session->records.swap(session->next_records);
+      session->next_records.clear();
+    }
+    if (!theorem_results.empty()) {
+      response["theorem_results"] = theorem_results;
+    }
+    response["timings"] = timings->to_json();
+    if (memory) {
+      memory->process_peak_rss = peak_rss_bytes();
+      if (report_memory) {
+        response["memory"] = memory->to_json();
+      }
+    }
+    return response;
+
+  } catch (const RequestCancelled &) {
+    return cancelled_response();
+  } catch (const ResourceExhausted &) {
+    return resource_exhausted_response(limit_mb);
+  } catch (const ProofError &e) {
+    return {{"ok", false}, {"status", "error"}, {"error", e.what()}};
+  } catch (const LibraryError &e) {
+    return {{"ok", false}, {"status", "error"}, {"error", e.what()}};
+  } catch (const z3::exception &e) {
+    if (cancel && cancel->cancelled()) {
+      return cancelled_response();
+    }
+    if (is_memout(e.msg())) {
+      return resource_exhausted_response(limit_mb);
+    }
+    return {{"ok", false},
+            {"status", "error"},
+            {"error", std::string("Z3 error: ") + e.msg()}};
+  } catch (const std::exception &e) {
+    return {{"ok", false},
+            {"status", "error"},
+            {"error", std::string("Internal error: ") + e.what()}};
   }
 }
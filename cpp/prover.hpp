@@ -0,0 +1,237 @@
+/*
+ * Proof Checker - Proof Engine
+ *
+ * The engine behind the prover executable (main.cpp): translation of
+ * proof ASTs to Z3, and prove(), which checks one JSON request. Linked as
+ * a library so benchmarks can drive the individual phases directly.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <z3++.h>
+
+using json = nlohmann::json;
+
+class ProofError : public std::runtime_error {
+public:
+  explicit ProofError(const std::string &msg) : std::runtime_error(msg) {}
+};
+
+class TermError : public ProofError {
+public:
+  explicit TermError(const std::string &msg)
+      : ProofError("Term error: " + msg) {}
+};
+
+class FormulaError : public ProofError {
+public:
+  explicit FormulaError(const std::string &msg)
+      : ProofError("Formula error: " + msg) {}
+};
+
+// Use std::map with expr stored via optional wrapper
+struct ExprWrapper {
+  std::optional<z3::expr> e;
+  ExprWrapper() = default;
+  ExprWrapper(z3::expr ex) : e(std::move(ex)) {}
+  operator z3::expr() const { return *e; }
+};
+
+using Environment = std::map<std::string, ExprWrapper>;
+using VarTypes = std::map<std::string, std::string>;
+
+/**
+ * Convert a term JSON object to a Z3 expression. Variables are looked up
+ * in env, and created there (Int or Real per var_types) on first use.
+ */
+z3::expr term_to_z3(const json &t, z3::context &ctx, Environment &env,
+                    const VarTypes &var_types);
+
+/**
+ * Convert a formula JSON object to a Z3 boolean expression.
+ */
+z3::expr formula_to_z3(const json &f, z3::context &ctx, Environment &env,
+                       const VarTypes &var_types);
+
+/**
+ * What a counterexample reports, from a request's "model" ("none",
+ * "relevant" or "full") and "model_format" ("exact" or "decimal") fields.
+ */
+struct ModelOptions {
+  enum class Scope { None, Relevant, Full };
+  Scope scope = Scope::Full;
+  // Real values as decimals with MODEL_DECIMAL_DIGITS fractional digits
+  // (ending in "?" where truncated) instead of exact rationals and
+  // root-obj algebraic numbers
+  bool decimal = false;
+
+  // Throws ProofError on an unknown value
+  static ModelOptions from_request(const json &req);
+};
+
+constexpr unsigned MODEL_DECIMAL_DIGITS = 10;
+
+// Sessions kept in --serve mode; past this the least recently used is dropped
+constexpr size_t MAX_SESSIONS = 256;
+
+/**
+ * Format a counterexample model: every variable in env, or only those in
+ * *only if given. Values are evaluated with model completion, one variable
+ * at a time.
+ */
+json format_model(const z3::model &m, const Environment &env,
+                  const ModelOptions &options = {},
+                  const std::set<std::string> *only = nullptr);
+
+/**
+ * Time one request spent in each phase, in microseconds. Returned as the
+ * "timings" object of every result; python/prover.py reports the same
+ * fields.
+ */
+struct Timings {
+  using Clock = std::chrono::steady_clock;
+
+  int64_t decode = 0;    // JSON request parsing (measured by the caller)
+  int64_t validate = 0;  // request fields, libraries and premises
+  int64_t theorems = 0;  // verify_theorems
+  int64_t translate = 0; // formula_to_z3
+  int64_t solve = 0;     // solver::check for steps, cases and the claim
+  int64_t model = 0;     // format_model
+  std::vector<int64_t> steps; // solve time of each top-level step
+  int64_t claim = 0;          // solve time of the claim
+
+  static int64_t since(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                                 start)
+        .count();
+  }
+
+  json to_json() const {
+    return {{"decode", decode},     {"validate", validate},
+            {"theorems", theorems}, {"translate", translate},
+            {"solve", solve},       {"model", model},
+            {"steps", steps},       {"claim", claim}};
+  }
+};
+
+/**
+ * Memory one request used, in bytes. Returned as the "memory" object of a
+ * result when the request sets "memory": true. The Z3 figures are growth
+ * over Z3's allocation estimate when the request started, so in the
+ * daemon they leave out what earlier requests left behind;
+ * process_peak_rss is the process's own high-water mark and includes it.
+ */
+struct MemoryUsage {
+  size_t ast = 0;              // decoded request JSON (estimated)
+  size_t z3_translate = 0;     // Z3 allocation growth after translating, at peak
+  size_t z3_solve = 0;         // Z3 allocation growth after solving, at peak
+  size_t process_peak_rss = 0; // process RSS high-water mark at the end
+  size_t z3_start = 0;         // Z3 allocation estimate at the start (not reported)
+
+  json to_json() const {
+    return {{"ast", ast},
+            {"z3_translate", z3_translate},
+            {"z3_solve", z3_solve},
+            {"process_peak_rss", process_peak_rss}};
+  }
+};
+
+/**
+ * Cancellation flag for one request. cancel() may be called from any
+ * thread and interrupts the Z3 context the request is solving in.
+ */
+class CancelToken {
+public:
+  void cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    if (ctx_) {
+      ctx_->interrupt();
+    }
+  }
+
+  bool cancelled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cancelled_;
+  }
+
+  // The context must stay alive until it is detached with attach(nullptr)
+  void attach(z3::context *ctx) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ctx_ = ctx;
+    if (ctx_ && cancelled_) {
+      ctx_->interrupt();
+    }
+  }
+
+private:
+  mutable std::mutex mutex_;
+  z3::context *ctx_ = nullptr;
+  bool cancelled_ = false;
+};
+
+// Receives each step_results entry as soon as that step has been checked
+using StepCallback = std::function<void(const json &)>;
+
+/**
+ * Main proof function. on_step, if set, is called with every step result
+ * before the claim is checked. Cancelling the token stops the check at
+ * the next solver call (or interrupts the running one) and yields a
+ * "cancelled" result. The result's "timings" are those of this call plus
+ * timings->decode, if the caller measured it. Memory is measured into
+ * *memory if given, and reported if the request asks for it.
+ */
+json prove(const json &req, const StepCallback &on_step = nullptr,
+           CancelToken *cancel = nullptr, Timings *timings = nullptr,
+           MemoryUsage *memory = nullptr);
+
+// The response for a request cancelled before or while it was checked
+json cancelled_response();
+
+/**
+ * Default for the "max_memory_mb" request field (0: no limit). A request
+ * whose decoded AST or Z3 allocation exceeds its limit ends with status
+ * "resource_exhausted".
+ */
+void set_memory_limit(size_t megabytes);
+
+/**
+ * Load a library artifact once, for every later request that names the
+ * same path in "libraries", and verify its theorems into the theorem
+ * cache under the variable types recorded with them. Requests use this
+ * copy even if the artifact changes on disk.
+ * Call before serving. Throws LibraryError.
+ */
+void preload_library(const std::string &artifact_path);
+
+/**
+ * Check a small built-in proof so that Z3's process-wide state is set up
+ * before the first request, e.g. in a process about to fork workers.
+ */
+void warm_up();
+
+/**
+ * Z3 context reuse. Instead of creating a context per request, each thread
+ * keeps up to capacity idle contexts (0 disables reuse) and recreates one
+ * after max_uses requests, which bounds the declarations and caches a
+ * context accumulates. Defaults: 2 contexts, 100 requests.
+ */
+void configure_context_pool(size_t capacity, size_t max_uses);
+
+/**
+ * Load verified theorem statuses from, and append new ones to, the cache
+ * file at path.
+ */
+void open_theorem_cache(const std::string &path);
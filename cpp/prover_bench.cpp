@@ -0,0 +1,267 @@
+/*
+ * Proof Checker - Engine Microbenchmarks
+ *
+ * Times the phases of a check separately on real inputs: JSON decode,
+ * translation to Z3, solver::check and format_model. Each input gets one
+ * benchmark per phase, named <phase>/<input>.
+ *
+ * Inputs are the request files listed in the file named by
+ * PROVER_BENCH_INPUT_LIST (python/test*.json and the examples/ ASTs,
+ * written by CMake), or the JSON request files given on the command line.
+ *
+ * Usage: ./prover_bench [--benchmark_filter=REGEX] [request.json ...]
+ */
+
+#include "prover.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Input {
+  std::string name;
+  std::string text;
+  json req;
+};
+
+std::string read_file(const std::string &path) {
+  std::ifstream in(path);
+  return std::string((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+}
+
+std::string stem(const std::string &path) {
+  size_t slash = path.find_last_of('/');
+  std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+  return name.substr(0, name.rfind('.'));
+}
+
+// An array member of j by reference (value() would copy), or an empty array
+const json &array_at(const json &j, const char *key) {
+  static const json empty = json::array();
+  auto it = j.find(key);
+  return it != j.end() && it->is_array() ? *it : empty;
+}
+
+/**
+ * Environment with the request's declared variables, as prove() sets it up.
+ */
+Environment declare(const json &req, z3::context &ctx, VarTypes &var_types) {
+  var_types.clear();
+  auto types = req.find("var_types");
+  if (types != req.end() && types->is_object()) {
+    for (auto &[name, type] : types->items()) {
+      var_types[name] = type.get<std::string>();
+    }
+  }
+  Environment env;
+  for (const auto &v : array_at(req, "vars")) {
+    std::string name = v.get<std::string>();
+    env[name] = ExprWrapper(var_types.count(name) && var_types[name] == "Int"
+                                ? ctx.int_const(name.c_str())
+                                : ctx.real_const(name.c_str()));
+  }
+  return env;
+}
+
+// Every formula prove() translates: assumptions, premises, step formulas
+// (including case conditions and case steps) and the claim
+void collect_formulas(const json &steps, std::vector<const json *> &out) {
+  for (const auto &step : steps) {
+    if (step.value("type", "") == "cases") {
+      for (const auto &c : array_at(step, "cases")) {
+        if (c.contains("condition")) {
+          out.push_back(&c["condition"]);
+        }
+        collect_formulas(array_at(c, "steps"), out);
+      }
+    } else if (step.contains("formula")) {
+      out.push_back(&step["formula"]);
+    }
+  }
+}
+
+std::vector<const json *> formulas(const json &req) {
+  std::vector<const json *> out;
+  for (const auto &a : array_at(req, "assumptions")) {
+    out.push_back(&a);
+  }
+  for (const auto &p : array_at(req, "premises")) {
+    if (p.contains("formula")) {
+      out.push_back(&p["formula"]);
+    }
+  }
+  collect_formulas(array_at(req, "steps"), out);
+  out.push_back(&req["claim"]);
+  return out;
+}
+
+/**
+ * Solver for the claim's obligation, the check every request ends with:
+ * assumptions, premises and top-level steps (as if all were proven) and
+ * the negated claim.
+ */
+z3::solver claim_solver(const json &req, z3::context &ctx, Environment &env,
+                        const VarTypes &var_types) {
+  z3::solver s(ctx);
+  for (const auto &a : array_at(req, "assumptions")) {
+    s.add(formula_to_z3(a, ctx, env, var_types));
+  }
+  for (const auto &p : array_at(req, "premises")) {
+    if (p.contains("formula")) {
+      s.add(formula_to_z3(p["formula"], ctx, env, var_types));
+    }
+  }
+  for (const auto &step : array_at(req, "steps")) {
+    if (step.contains("formula")) {
+      s.add(formula_to_z3(step["formula"], ctx, env, var_types));
+    }
+  }
+  s.add(!formula_to_z3(req["claim"], ctx, env, var_types));
+  return s;
+}
+
+void bench_decode(benchmark::State &state, const Input &input) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(json::parse(input.text));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(input.text.size()));
+}
+
+void bench_translate(benchmark::State &state, const Input &input) {
+  std::vector<const json *> fs = formulas(input.req);
+  for (auto _ : state) {
+    // A fresh context each time, so Z3 cannot hand back cached terms
+    state.PauseTiming();
+    z3::context ctx;
+    VarTypes var_types;
+    Environment env = declare(input.req, ctx, var_types);
+    state.ResumeTiming();
+    for (const json *f : fs) {
+      benchmark::DoNotOptimize(formula_to_z3(*f, ctx, env, var_types));
+    }
+  }
+  state.counters["formulas"] = static_cast<double>(fs.size());
+}
+
+void bench_check(benchmark::State &state, const Input &input) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    z3::context ctx;
+    VarTypes var_types;
+    Environment env = declare(input.req, ctx, var_types);
+    z3::solver s = claim_solver(input.req, ctx, env, var_types);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(s.check());
+  }
+}
+
+void bench_format_model(benchmark::State &state, const Input &input) {
+  z3::context ctx;
+  VarTypes var_types;
+  Environment env = declare(input.req, ctx, var_types);
+  z3::solver s = claim_solver(input.req, ctx, env, var_types);
+  if (s.check() != z3::sat) {
+    state.SkipWithError("claim holds; no counterexample to format");
+    return;
+  }
+  z3::model m = s.get_model();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format_model(m, env));
+  }
+}
+
+/**
+ * Check the claim once. Returns false (with the reason in error) if the
+ * input cannot be translated; otherwise sets whether the claim has a
+ * counterexample for format_model to benchmark.
+ */
+bool probe(const json &req, bool &counterexample, std::string &error) {
+  try {
+    z3::context ctx;
+    VarTypes var_types;
+    Environment env = declare(req, ctx, var_types);
+    for (const json *f : formulas(req)) {
+      formula_to_z3(*f, ctx, env, var_types);
+    }
+    counterexample = claim_solver(req, ctx, env, var_types).check() == z3::sat;
+    return true;
+  } catch (const std::exception &e) {
+    error = e.what();
+    return false;
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+
+  // Arguments Google Benchmark did not consume are input files
+  std::vector<std::string> paths(argv + 1, argv + argc);
+#ifdef PROVER_BENCH_INPUT_LIST
+  if (paths.empty()) {
+    std::istringstream list(read_file(PROVER_BENCH_INPUT_LIST));
+    for (std::string line; std::getline(list, line);) {
+      if (!line.empty()) {
+        paths.push_back(line);
+      }
+    }
+  }
+#endif
+  if (paths.empty()) {
+    std::cerr << "Usage: prover_bench [benchmark flags] request.json ..."
+              << std::endl;
+    return 2;
+  }
+
+  // Registered benchmarks keep references, so inputs must not move
+  std::vector<Input> inputs;
+  inputs.reserve(paths.size());
+  for (const auto &path : paths) {
+    Input input{stem(path), read_file(path), json()};
+    try {
+      input.req = json::parse(input.text);
+    } catch (const json::parse_error &e) {
+      std::cerr << path << ": " << e.what() << std::endl;
+      return 1;
+    }
+    if (!input.req.is_object() || !input.req.contains("claim")) {
+      std::cerr << path << ": not a proof request" << std::endl;
+      return 1;
+    }
+    inputs.push_back(std::move(input));
+  }
+
+  for (const Input &input : inputs) {
+    bool counterexample = false;
+    std::string error;
+    if (!probe(input.req, counterexample, error)) {
+      std::cerr << "Skipping " << input.name << ": " << error << std::endl;
+      continue;
+    }
+    benchmark::RegisterBenchmark(("decode/" + input.name).c_str(), bench_decode,
+                                 std::cref(input));
+    benchmark::RegisterBenchmark(("translate/" + input.name).c_str(),
+                                 bench_translate, std::cref(input));
+    benchmark::RegisterBenchmark(("check/" + input.name).c_str(), bench_check,
+                                 std::cref(input));
+    if (counterexample) {
+      benchmark::RegisterBenchmark(("format_model/" + input.name).c_str(),
+                                   bench_format_model, std::cref(input));
+    }
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Proof Checker - Trace Events
+ */
+
+#include "trace.hpp"
+
+#include <fstream>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Small sequential ids keep the tracks in thread creation order
+int thread_track() {
+  static std::atomic<int> next{1};
+  thread_local int track = next++;
+  return track;
+}
+
+} // namespace
+
+int64_t Tracer::micros(Clock::time_point t) const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(t - origin_)
+      .count();
+}
+
+void Tracer::name_thread(const std::string &name) {
+  if (!enabled_) {
+    return;
+  }
+  json event = {{"name", "thread_name"},
+                {"ph", "M"},
+                {"pid", ::getpid()},
+                {"tid", thread_track()},
+                {"args", {{"name", name}}}};
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back(std::move(event));
+}
+
+void Tracer::complete(const std::string &name, Clock::time_point start,
+                      Clock::time_point end, json args) {
+  json event = {{"name", name},
+                {"ph", "X"},
+                {"ts", micros(start)},
+                {"dur", micros(end) - micros(start)},
+                {"pid", ::getpid()},
+                {"tid", thread_track()},
+                {"args", std::move(args)}};
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back(std::move(event));
+}
+
+bool Tracer::write(const std::string &path) const {
+  json out;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out = {{"traceEvents", events_}, {"displayTimeUnit", "ms"}};
+  }
+  std::ofstream file(path);
+  file << out.dump() << '\n';
+  return static_cast<bool>(file);
+}
+
+Tracer &tracer() {
+  static Tracer instance;
+  return instance;
+}
@@ -0,0 +1,77 @@
+/*
+ * Proof Checker - Trace Events
+ *
+ * Records spans in the Chrome trace-event format (chrome://tracing,
+ * ui.perfetto.dev): one track per thread, with nested spans for requests
+ * and the phases inside them. Tracing is off unless enabled, in which
+ * case a TraceSpan costs nothing beyond a flag check.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Tracer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void enable() { enabled_ = true; }
+  bool enabled() const { return enabled_; }
+
+  // Label the calling thread's track
+  void name_thread(const std::string &name);
+  // A finished span on the calling thread's track
+  void complete(const std::string &name, Clock::time_point start,
+                Clock::time_point end, nlohmann::json args);
+  // Write every recorded event as {"traceEvents": [...]}; false on I/O error
+  bool write(const std::string &path) const;
+
+private:
+  int64_t micros(Clock::time_point t) const;
+
+  std::atomic<bool> enabled_{false};
+  Clock::time_point origin_ = Clock::now();
+  mutable std::mutex mutex_;
+  std::vector<nlohmann::json> events_;
+};
+
+Tracer &tracer();
+
+/**
+ * Records the lifetime of a scope as a span when tracing is enabled.
+ * Arguments added with arg() show up on the span (request id, status, ...).
+ */
+class TraceSpan {
+public:
+  explicit TraceSpan(const char *name)
+      : name_(tracer().enabled() ? name : nullptr) {
+    if (name_) {
+      start_ = Tracer::Clock::now();
+    }
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+  ~TraceSpan() {
+    if (name_) {
+      tracer().complete(name_, start_, Tracer::Clock::now(), std::move(args_));
+    }
+  }
+
+  template <typename T> void arg(const char *key, T &&value) {
+    if (name_) {
+      args_[key] = std::forward<T>(value);
+    }
+  }
+
+private:
+  const char *name_;
+  Tracer::Clock::time_point start_;
+  nlohmann::json args_ = nlohmann::json::object();
+};
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+Proof Checker - Synthetic Corpus Generator
+
+Generates parametrized families of proofs for scaling benchmarks. Each
+family grows along one dimension, so translation and solve time can be
+measured against it:
+
+    chain       N-long inequality chain x0 < x1 < ... < xN
+    sum         sum of N positive variables
+    product     product of N positive variables (degree N)
+    cases       case split on the signs of N variables (2^N cases)
+    apply       M applications of stdlib positive_sum
+    minmax      min and max over N variables
+    quantifier  N forall/exists alternations
+
+Every instance is written as a .proof file and as its JSON request, and
+listed in manifest.json with the status it is expected to get. With
+--disproven each family also gets a variant whose claim does not follow.
+
+Usage:
+    python corpus.py OUT_DIR                       Default families and sizes
+    python corpus.py OUT_DIR --family chain --sizes 8,64,512
+    python corpus.py OUT_DIR --disproven
+"""
+
+import argparse
+import json
+import os
+import sys
+
+from parser import parse_file, ParseError
+
+
+STDLIB = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                      "..", "stdlib", "arithmetic.proof")
+
+
+def variables(n, prefix="x"):
+    return [f"{prefix}{i}" for i in range(n)]
+
+
+def chain(n, disproven=False):
+    """x0 < x1 < ... < xN, one assumption per link."""
+    xs = variables(n + 1)
+    lines = [f"assume {a} < {b}" for a, b in zip(xs, xs[1:])]
+    claim = f"{xs[-1]} < {xs[0]}" if disproven else f"{xs[0]} < {xs[-1]}"
+    return lines + [f"prove {claim}"]
+
+
+def positive_sum(n, disproven=False):
+    """N positive variables have a positive sum."""
+    xs = variables(n)
+    total = " + ".join(xs)
+    claim = f"{total} > 1" if disproven else f"{total} > 0"
+    return [f"assume {x} > 0" for x in xs] + [f"prove {claim}"]
+
+
+def product(n, disproven=False):
+    """N positive variables have a positive product, a degree-N term."""
+    xs = variables(n)
+    term = " * ".join(xs)
+    claim = f"{term} > 1" if disproven else f"{term} > 0"
+    return [f"assume {x} > 0" for x in xs] + [f"prove {claim}"]
+
+
+def sign_cases(n, disproven=False):
+    """A case for every sign combination of N variables.
+
+    The DSL has no nested cases blocks, so depth N is one block with the
+    2^N cases a nested split would reach. Each case shows the sum of
+    absolute values is non-negative with the signs resolved.
+    """
+    xs = variables(n)
+    lines = ["cases:"]
+    for signs in range(2 ** n):
+        negative = [bool(signs >> i & 1) for i in range(n)]
+        condition = " and ".join(f"{x} < 0" if neg else f"{x} >= 0"
+                                 for x, neg in zip(xs, negative))
+        total = " + ".join(f"-{x}" if neg else x
+                           for x, neg in zip(xs, negative))
+        lines.append(f"    case {condition}:")
+        lines.append(f"        have {total} >= 0")
+    total = " + ".join(f"abs({x})" for x in xs)
+    claim = f"{total} > 0" if disproven else f"{total} >= 0"
+    return lines + [f"prove {claim}"]
+
+
+def applications(m, disproven=False):
+    """M uses of stdlib positive_sum, each adding one more variable."""
+    xs = variables(m + 1)
+    lines = [f'import "{os.path.abspath(STDLIB)}"']
+    lines += [f"assume {x} > 0" for x in xs]
+    for i in range(1, m + 1):
+        lines.append(f"apply positive_sum({' + '.join(xs[:i])}, {xs[i]})")
+    total = " + ".join(xs)
+    claim = f"{total} > 1" if disproven else f"{total} > 0"
+    return lines + [f"prove {claim}"]
+
+
+def minmax(n, disproven=False):
+    """min over N variables is at most max over them."""
+    xs = variables(n)
+
+    def fold(fn, terms):
+        term = terms[-1]
+        for t in reversed(terms[:-1]):
+            term = f"{fn}({t}, {term})"
+        return term
+
+    op = "<" if disproven else "<="
+    return [f"prove {fold('min', xs)} {op} {fold('max', xs)}"]
+
+
+def alternations(n, disproven=False):
+    """forall a0. exists b0. forall a1. exists b1 ... with each bi at least ai.
+
+    The disproven variant asks for each bi to lie below every ai instead,
+    which fails at the first alternation.
+    """
+    prefix = ""
+    body = []
+    for i in range(n):
+        prefix += f"forall a{i}. exists b{i}. "
+        body.append(f"b{i} < a{i}" if disproven else f"b{i} >= a{i}")
+    if disproven:
+        prefix = prefix.replace("forall", "FORALL").replace(
+            "exists", "forall").replace("FORALL", "exists")
+    return [f"prove {prefix}{' and '.join(body)}"]
+
+
+# name -> (generator, default sizes, what a size counts)
+FAMILIES = {
+    "chain": (chain, [4, 16, 64, 256], "links"),
+    "sum": (positive_sum, [4, 16, 64, 256], "variables"),
+    "product": (product, [2, 4, 8, 16], "factors"),
+    "cases": (sign_cases, [1, 2, 4, 6], "variables"),
+    "apply": (applications, [1, 4, 16, 64], "applications"),
+    "minmax": (minmax, [2, 8, 32, 128], "variables"),
+    "quantifier": (alternations, [1, 2, 4, 6], "alternations"),
+}
+
+
+def generate(family, size, disproven=False):
+    """Source text and expected status of one instance."""
+    fn, _, unit = FAMILIES[family]
+    header = [f"# Generated by corpus.py: {family} family, {size} {unit}", ""]
+    source = "\n".join(header + fn(size, disproven)) + "\n"
+    return source, "disproven" if disproven else "proven"
+
+
+def write_corpus(out_dir, families=None, sizes=None, disproven=False):
+    """Write every instance and manifest.json to out_dir.
+
+    Returns the manifest entries: name, family, size, the .proof and .json
+    paths (relative to out_dir) and the expected status.
+    """
+    os.makedirs(out_dir, exist_ok=True)
+    manifest = []
+    for family in families or FAMILIES:
+        for size in sizes or FAMILIES[family][1]:
+            variants = [False, True] if disproven else [False]
+            for negated in variants:
+                name = f"{family}_{size}" + ("_disproven" if negated else "")
+                source, expected = generate(family, size, negated)
+                proof_path = os.path.join(out_dir, name + ".proof")
+                with open(proof_path, "w") as f:
+                    f.write(source)
+                with open(os.path.join(out_dir, name + ".json"), "w") as f:
+                    json.dump(parse_file(proof_path), f)
+                manifest.append({
+                    "name": name,
+                    "family": family,
+                    "size": size,
+                    "proof": name + ".proof",
+                    "request": name + ".json",
+                    "expected": expected,
+                })
+    with open(os.path.join(out_dir, "manifest.json"), "w") as f:
+        json.dump(manifest, f, indent=2)
+    return manifest
+
+
+def main():
+    arg_parser = argparse.ArgumentParser(
+        description="Generate a synthetic proof corpus for scaling benchmarks")
+    arg_parser.add_argument("out_dir", help="Directory to write the corpus to")
+    arg_parser.add_argument("--family", action="append",
+                            choices=sorted(FAMILIES),
+                            help="Family to generate (repeatable; default: all)")
+    arg_parser.add_argument("--sizes",
+                            help="Comma-separated sizes (default: per family)")
+    arg_parser.add_argument("--disproven", action="store_true",
+                            help="Also generate a disproven variant of each")
+    args = arg_parser.parse_args()
+
+    sizes = None
+    if args.sizes:
+        try:
+            sizes = [int(s) for s in args.sizes.split(",")]
+        except ValueError:
+            arg_parser.error(f"--sizes must be integers: {args.sizes}")
+        if any(s < 1 for s in sizes):
+            arg_parser.error("--sizes must be positive")
+
+    try:
+        manifest = write_corpus(args.out_dir, args.family, sizes,
+                                args.disproven)
+    except ParseError as e:
+        print(f"Parse error: {e}", file=sys.stderr)
+        sys.exit(1)
+    print(f"Wrote {len(manifest)} proofs to {args.out_dir}")
+
+
+if __name__ == "__main__":
+    main()
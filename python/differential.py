@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+Proof Checker - Differential Benchmark
+
+Checks every proof of the perf_gate.py corpus (examples, stdlib theorems and
+generated families), plus any request files given, with both provers: the
+Python prove() in this process and the C++ engine on one
+`prover --serve --no-cache` process. Reports each proof's median latency on
+both sides, the speedup, and every disagreement in the claim or step
+statuses. Exits with 1 if the provers disagree on any proof.
+
+Usage:
+    python differential.py --prover cpp/build/prover
+    python differential.py --prover cpp/build/prover --repeat 1 my_request.json
+"""
+
+import argparse
+import json
+import math
+import os
+import sys
+import tempfile
+import time
+
+from native import NativeProver, EngineError
+from perf_gate import corpus, percentile
+from prover import prove, DEFAULT_PREMISE_LIMIT
+
+
+def python_check(request):
+    """Check a request with the Python prover, as prover.py's main() does."""
+    return prove(request.get("assumptions", []), request["claim"],
+                 request.get("vars", []), request.get("var_types", {}),
+                 request.get("steps", []), request.get("premises", []),
+                 request.get("premise_limit", DEFAULT_PREMISE_LIMIT))
+
+
+def timed(check, request, repeat):
+    """Last result and median latency (ms) of repeat checks after a warm-up."""
+    result = check(request)
+    samples = []
+    for _ in range(repeat):
+        start = time.perf_counter()
+        result = check(request)
+        samples.append((time.perf_counter() - start) * 1000)
+    return result, percentile(samples, 50)
+
+
+def statuses(result):
+    """Claim and step statuses of a result: {"claim": s, "step 1": s, ...}."""
+    out = {"claim": result.get("status")}
+    for entry in result.get("step_results", []):
+        out[f"step {entry['step']}"] = entry.get("status")
+    return out
+
+
+def disagreements(py_result, cpp_result):
+    """Obligations whose status differs, as "what: python vs c++" strings."""
+    py, cpp = statuses(py_result), statuses(cpp_result)
+    return [f"{key}: {py.get(key, '-')} vs {cpp.get(key, '-')}"
+            for key in sorted(set(py) | set(cpp), key=lambda k: k != "claim")
+            if py.get(key) != cpp.get(key)]
+
+
+def main():
+    arg_parser = argparse.ArgumentParser(
+        description="Compare the Python and C++ provers on the benchmark corpus")
+    arg_parser.add_argument("requests", nargs="*",
+                            help="Extra JSON request files to check")
+    arg_parser.add_argument("--prover", required=True,
+                            help="Path to the C++ prover binary")
+    arg_parser.add_argument("--repeat", type=int, default=5,
+                            help="Timed checks per proof and prover (default: 5)")
+    args = arg_parser.parse_args()
+    if args.repeat < 1:
+        arg_parser.error("--repeat must be positive")
+
+    rows = []
+    engine = NativeProver(args.prover, args=["--no-cache"])
+    try:
+        with tempfile.TemporaryDirectory() as work_dir:
+            proofs = [(name, request) for name, request, _ in corpus(work_dir)]
+            for path in args.requests:
+                with open(path) as f:
+                    proofs.append((os.path.basename(path), json.load(f)))
+            for name, request in proofs:
+                py_result, py_ms = timed(python_check, request, args.repeat)
+                cpp_result, cpp_ms = timed(engine.check, request, args.repeat)
+                rows.append((name, py_ms, cpp_ms,
+                             disagreements(py_result, cpp_result)))
+    except EngineError as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
+    finally:
+        engine.close()
+
+    print(f"{'proof':32} {'python ms':>10} {'c++ ms':>10} {'speedup':>8}  statuses")
+    for name, py_ms, cpp_ms, diff in rows:
+        print(f"{name:32} {py_ms:10.1f} {cpp_ms:10.1f} {py_ms / cpp_ms:7.1f}x  "
+              + ("; ".join(diff) if diff else "agree"))
+
+    disagreeing = [row for row in rows if row[3]]
+    speedup = math.exp(sum(math.log(py / cpp) for _, py, cpp, _ in rows)
+                       / len(rows))
+    print(f"\n{len(rows) - len(disagreeing)}/{len(rows)} proofs agree, "
+          f"geometric mean speedup {speedup:.1f}x")
+    sys.exit(1 if disagreeing else 0)
+
+
+if __name__ == "__main__":
+    main()
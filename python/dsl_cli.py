@@ -69,7 +69,8 @@ def verify_file(filename: str, verbose: bool = True, json_output: bool = False):
         result = prove(
             ast["assumptions"],
             ast["claim"],
-            ast["vars"]
+            ast["vars"],
+            premises=ast.get("premises", [])
         )
         
         print_result(result, verbose)
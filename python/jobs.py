@@ -0,0 +1,271 @@
+#!/usr/bin/env python3
+"""
+Proof Checker - Job Queue
+
+A bounded queue of proof checks served by a fixed pool of worker threads.
+Each worker owns its own checker (typically a persistent native prover,
+see native.py), so a slow proof only occupies one worker and submitting
+never blocks the caller.
+
+Usage:
+    def make_checker():
+        engine = NativeProver()
+        return lambda ast, on_step, cancel, session: engine.check(
+            ast, session=session, on_step=on_step, cancel=cancel)
+
+    queue = JobQueue(make_checker, workers=4)
+    job_id = queue.submit(ast, session="editor-1")
+    job = queue.wait(job_id, timeout=30)   # or queue.get(job_id) to poll
+
+Step results reported by a checker while it runs are kept with the job, so
+clients can stream them with events() before the whole check finishes.
+
+Submitting a job for a session supersedes that session's unfinished jobs:
+queued ones are dropped, and running ones have their cancel token
+cancelled. Either way their result is CANCELLED. All of a session's jobs
+run on the same worker, so a checker that keeps per-session state (like
+the native prover's incremental sessions) sees every revision; the
+session is released once none of its jobs are retained any more.
+"""
+
+import collections
+import threading
+import time
+import uuid
+
+
+QUEUED = "queued"
+RUNNING = "running"
+DONE = "done"
+
+CANCELLED = {"ok": False, "status": "cancelled",
+             "message": "Superseded by a newer revision."}
+
+
+class QueueFull(Exception):
+    """The queue already holds its maximum number of pending jobs."""
+    pass
+
+
+class CancelToken:
+    """Cancellation flag for one job. Callbacks registered with
+    add_callback() run once, when the token is cancelled (immediately if
+    it already is)."""
+
+    def __init__(self):
+        self.cancelled = False
+        self._callbacks = []
+        self._lock = threading.Lock()
+
+    def add_callback(self, fn):
+        with self._lock:
+            if not self.cancelled:
+                self._callbacks.append(fn)
+                return
+        fn()
+
+    def cancel(self):
+        with self._lock:
+            if self.cancelled:
+                return
+            self.cancelled = True
+            callbacks, self._callbacks = self._callbacks, []
+        for fn in callbacks:
+            fn()
+
+
+class Job:
+    def __init__(self, request, session=None):
+        self.id = uuid.uuid4().hex
+        self.request = request
+        self.session = session
+        self.token = CancelToken()
+        self.state = QUEUED
+        self.result = None
+        self.events = []  # step_results entries reported so far
+        self.submitted = time.monotonic()
+        self.finished = None
+
+    def to_dict(self) -> dict:
+        out = {"job_id": self.id, "state": self.state}
+        if self.state == DONE:
+            out["result"] = self.result
+        return out
+
+
+class JobQueue:
+    """Fixed pool of workers checking queued proof ASTs.
+
+    Args:
+        make_checker: Called once per worker thread; returns the function
+                      (ast, on_step, cancel, session) -> result dict that
+                      worker uses for every job. It should call on_step with
+                      each step result as soon as that step has been
+                      checked, and stop early once the CancelToken `cancel`
+                      is cancelled. `session` is the id the job was
+                      submitted with, or None.
+        workers: Number of worker threads
+        max_pending: Jobs allowed to wait before submit() raises QueueFull
+        retention: Seconds a finished job stays available for polling
+    """
+
+    def __init__(self, make_checker, workers: int = 2, max_pending: int = 256,
+                 retention: float = 600.0):
+        self.max_pending = max_pending
+        self.retention = retention
+        self._jobs = {}  # id -> Job
+        self._queue = collections.deque()
+        self._owners = {}  # session -> index of the worker running its jobs
+        self._cond = threading.Condition()
+        self._stopped = False
+        self._threads = [
+            threading.Thread(target=self._work, args=(make_checker, i), daemon=True)
+            for i in range(max(1, workers))
+        ]
+        for t in self._threads:
+            t.start()
+
+    def submit(self, request, session: str = None) -> str:
+        """Queue a check and return its job id. A session's newest job
+        supersedes its earlier unfinished ones."""
+        running = []
+        with self._cond:
+            self._prune()
+            if session is not None:
+                running = self._supersede(session)
+            if len(self._queue) >= self.max_pending:
+                raise QueueFull(f"{len(self._queue)} jobs already pending")
+            job = Job(request, session)
+            self._jobs[job.id] = job
+            self._queue.append(job)
+            self._cond.notify_all()
+        # Cancel callbacks may talk to an engine; run them without the lock
+        for old in running:
+            old.token.cancel()
+        return job.id
+
+    def get(self, job_id: str):
+        """Current state of a job as a dict, or None if unknown/expired."""
+        with self._cond:
+            job = self._jobs.get(job_id)
+            return job.to_dict() if job else None
+
+    def wait(self, job_id: str, timeout: float = None):
+        """Block until a job is done or the timeout expires, then return
+        its state as get() would."""
+        deadline = None if timeout is None else time.monotonic() + timeout
+        with self._cond:
+            job = self._jobs.get(job_id)
+            while job is not None and job.state != DONE:
+                remaining = None if deadline is None else deadline - time.monotonic()
+                if remaining is not None and remaining <= 0:
+                    break
+                self._cond.wait(remaining)
+            return job.to_dict() if job else None
+
+    def events(self, job_id: str, start: int = 0, timeout: float = None):
+        """Wait until a job has reported more than `start` step results or
+        is done, or the timeout expires.
+
+        Returns (new step results, job state as get() would), or None if
+        the job is unknown.
+        """
+        deadline = None if timeout is None else time.monotonic() + timeout
+        with self._cond:
+            job = self._jobs.get(job_id)
+            if job is None:
+                return None
+            while len(job.events) <= start and job.state != DONE:
+                remaining = None if deadline is None else deadline - time.monotonic()
+                if remaining is not None and remaining <= 0:
+                    break
+                self._cond.wait(remaining)
+            return job.events[start:], job.to_dict()
+
+    def pending(self) -> int:
+        with self._cond:
+            return len(self._queue)
+
+    def stop(self):
+        """Stop the workers once their current jobs finish."""
+        with self._cond:
+            self._stopped = True
+            self._cond.notify_all()
+        for t in self._threads:
+            t.join()
+
+    def _supersede(self, session):
+        """Drop the session's queued jobs and return its running ones.
+        Caller holds the lock."""
+        running = []
+        for job in list(self._jobs.values()):
+            if job.session != session or job.state == DONE:
+                continue
+            if job.state == QUEUED:
+                self._queue.remove(job)
+                self._finish(job, dict(CANCELLED))
+            else:
+                running.append(job)
+        return running
+
+    def _finish(self, job, result):
+        # Caller holds the lock
+        job.result = result
+        job.state = DONE
+        job.finished = time.monotonic()
+        self._cond.notify_all()
+
+    def _prune(self):
+        # Caller holds the lock
+        now = time.monotonic()
+        expired = [job_id for job_id, job in self._jobs.items()
+                   if job.finished is not None and now - job.finished > self.retention]
+        for job_id in expired:
+            del self._jobs[job_id]
+        live = {job.session for job in self._jobs.values()}
+        for session in [s for s in self._owners if s not in live]:
+            del self._owners[session]
+
+    def _next_job(self, worker):
+        """Take the oldest queued job this worker may run: one without a
+        session, or whose session is unclaimed or already this worker's.
+        Caller holds the lock."""
+        for job in self._queue:
+            if job.session is None:
+                break
+            owner = self._owners.setdefault(job.session, worker)
+            if owner == worker:
+                break
+        else:
+            return None
+        self._queue.remove(job)
+        return job
+
+    def _work(self, make_checker, worker):
+        check = make_checker()
+        while True:
+            with self._cond:
+                job = None
+                while not self._stopped:
+                    job = self._next_job(worker)
+                    if job is not None:
+                        break
+                    self._cond.wait()
+                if self._stopped:
+                    return
+                job.state = RUNNING
+
+            def on_step(step_result, job=job):
+                with self._cond:
+                    job.events.append(step_result)
+                    self._cond.notify_all()
+
+            try:
+                result = check(job.request, on_step, job.token, job.session)
+            except Exception as e:
+                result = {"ok": False, "status": "error", "error": f"Internal error: {e}"}
+            if job.token.cancelled:
+                result = dict(CANCELLED)
+
+            with self._cond:
+                self._finish(job, result)
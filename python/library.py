@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""
+Proof Checker - Precompiled Theorem Libraries
+
+Compiles a .proof library into a binary artifact next to it
+(stdlib/arithmetic.proof -> stdlib/arithmetic.plib) holding the theorem
+ASTs, the verified status of each theorem, and the content hash of every
+source file the library was built from, i.e. the library itself and all
+of its transitive imports.
+
+The parser loads a fresh artifact instead of re-lexing and re-parsing the
+library. An artifact is ignored as soon as any recorded source hash no
+longer matches the file on disk.
+
+Artifact layout (little-endian):
+    magic           8 bytes   b"PROOFLIB"
+    version         u32
+    source count    u32
+    payload offset  u64
+    payload size    u64
+    source table    per source: u64 FNV-1a hash, u32 path length, path
+                    (UTF-8, relative to the artifact's directory)
+    payload         UTF-8 JSON: {"theorems": {name: {assumptions,
+                    conclusion, var_types, status}}}
+
+A theorem's var_types are the declared types of its variables in the
+library, the types its status was verified under. Undeclared variables
+are Real.
+
+Usage:
+    python library.py [--no-verify] <library.proof> ...
+"""
+
+import json
+import mmap
+import os
+import struct
+import sys
+
+from parser import Lexer, Parser
+
+
+ARTIFACT_MAGIC = b"PROOFLIB"
+ARTIFACT_VERSION = 2
+ARTIFACT_EXT = ".plib"
+
+_HEADER = struct.Struct("<8sIIQQ")
+_SOURCE = struct.Struct("<QI")
+
+_FNV_OFFSET = 0xcbf29ce484222325
+_FNV_PRIME = 0x100000001b3
+
+
+class LibraryError(Exception):
+    """Malformed or unreadable library artifact."""
+    pass
+
+
+def content_hash(data: bytes) -> int:
+    """64-bit FNV-1a hash of a source file's bytes (matches cpp/library.cpp)."""
+    h = _FNV_OFFSET
+    for byte in data:
+        h = ((h ^ byte) * _FNV_PRIME) & 0xffffffffffffffff
+    return h
+
+
+def file_hash(path: str) -> int:
+    with open(path, 'rb') as f:
+        return content_hash(f.read())
+
+
+def artifact_path(source_path: str) -> str:
+    """Artifact location for a library source file."""
+    return os.path.splitext(source_path)[0] + ARTIFACT_EXT
+
+
+def write_artifact(path: str, sources, theorems):
+    """Write an artifact.
+
+    Args:
+        path: Artifact file to write
+        sources: List of (absolute source path, content hash)
+        theorems: Theorem name -> {assumptions, conclusion, var_types, status}
+    """
+    base = os.path.dirname(os.path.abspath(path))
+    table = b""
+    for src, h in sources:
+        rel = os.path.relpath(src, base).encode("utf-8")
+        table += _SOURCE.pack(h, len(rel)) + rel
+    payload = json.dumps({"theorems": theorems}, separators=(",", ":")).encode("utf-8")
+    offset = _HEADER.size + len(table)
+    header = _HEADER.pack(ARTIFACT_MAGIC, ARTIFACT_VERSION, len(sources), offset, len(payload))
+
+    # Write to a temporary file first so readers never see a partial artifact
+    tmp = path + ".tmp"
+    with open(tmp, 'wb') as f:
+        f.write(header + table + payload)
+    os.replace(tmp, path)
+
+
+def read_artifact(path: str):
+    """Memory-map an artifact and decode it.
+
+    Returns a dict with "sources" (list of (absolute path, hash)) and
+    "theorems". Raises LibraryError if the file is not a valid artifact.
+    """
+    base = os.path.dirname(os.path.abspath(path))
+    try:
+        with open(path, 'rb') as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as m:
+            if len(m) < _HEADER.size:
+                raise LibraryError(f"{path}: truncated header")
+            magic, version, count, offset, size = _HEADER.unpack_from(m, 0)
+            if magic != ARTIFACT_MAGIC:
+                raise LibraryError(f"{path}: not a library artifact")
+            if version != ARTIFACT_VERSION:
+                raise LibraryError(f"{path}: unsupported artifact version {version}")
+            if offset + size > len(m):
+                raise LibraryError(f"{path}: truncated payload")
+
+            sources = []
+            pos = _HEADER.size
+            for _ in range(count):
+                if pos + _SOURCE.size > offset:
+                    raise LibraryError(f"{path}: truncated source table")
+                h, length = _SOURCE.unpack_from(m, pos)
+                pos += _SOURCE.size
+                rel = m[pos:pos + length].decode("utf-8")
+                pos += length
+                sources.append((os.path.normpath(os.path.join(base, rel)), h))
+
+            payload = json.loads(m[offset:offset + size].decode("utf-8"))
+    except (OSError, ValueError) as e:
+        raise LibraryError(f"{path}: {e}")
+
+    return {"sources": sources, "theorems": payload.get("theorems", {})}
+
+
+def theorem_symbols(node, symbols=None) -> set:
+    """Names of all variables in a theorem, formula or term AST."""
+    if symbols is None:
+        symbols = set()
+    if isinstance(node, dict):
+        if node.get("type") == "var" and "name" in node:
+            symbols.add(node["name"])
+        for value in node.values():
+            theorem_symbols(value, symbols)
+    elif isinstance(node, list):
+        for item in node:
+            theorem_symbols(item, symbols)
+    return symbols
+
+
+def theorem_var_types(theorem, var_types) -> dict:
+    """The types a theorem is checked under: its own recorded var_types if
+    it has them (it was imported from an artifact), otherwise the declared
+    types among var_types of the variables it mentions."""
+    if "var_types" in theorem:
+        return theorem["var_types"]
+    symbols = theorem_symbols([theorem["assumptions"], theorem["conclusion"]])
+    return {v: t for v, t in var_types.items() if v in symbols}
+
+
+def load_library(source_path: str):
+    """Load the theorems of a library from its artifact.
+
+    Returns {"sources": [absolute paths], "theorems": {...}}, or None if
+    there is no artifact or it is stale or unreadable.
+    """
+    path = artifact_path(source_path)
+    if not os.path.exists(path):
+        return None
+    try:
+        artifact = read_artifact(path)
+        for src, h in artifact["sources"]:
+            if file_hash(src) != h:
+                return None
+    except (LibraryError, OSError):
+        return None
+    return {
+        "sources": [src for src, _ in artifact["sources"]],
+        "theorems": artifact["theorems"],
+    }
+
+
+def compile_library(source_path: str, verify: bool = True) -> str:
+    """Compile a .proof library into an artifact and return its path.
+
+    With verify=True every theorem is proven from its own assumptions and
+    its status recorded; otherwise theorems are marked "unverified".
+    """
+    source_path = os.path.abspath(source_path)
+    with open(source_path, 'r') as f:
+        source = f.read()
+
+    parser = Parser(Lexer(source).tokenize(), os.path.dirname(source_path))
+    parser.imported_files.add(source_path)
+    parser.parse_library()
+
+    theorems = {}
+    for name, theorem in parser.theorems.items():
+        theorems[name] = {
+            "assumptions": theorem["assumptions"],
+            "conclusion": theorem["conclusion"],
+            "var_types": theorem_var_types(theorem, parser.var_types),
+            "status": theorem.get("status", "unverified"),
+        }
+
+    if verify:
+        from prover import prove
+        for name, theorem in theorems.items():
+            if theorem["status"] == "unverified":
+                result = prove(theorem["assumptions"], theorem["conclusion"],
+                               var_types=theorem["var_types"])
+                theorem["status"] = result["status"]
+
+    sources = [(src, file_hash(src)) for src in sorted(parser.imported_files)]
+    path = artifact_path(source_path)
+    write_artifact(path, sources, theorems)
+    return path
+
+
+def main():
+    args = sys.argv[1:]
+    verify = True
+    if "--no-verify" in args:
+        verify = False
+        args = [a for a in args if a != "--no-verify"]
+
+    if not args:
+        print("Usage: python library.py [--no-verify] <library.proof> ...")
+        sys.exit(1)
+
+    failed = False
+    for source_path in args:
+        try:
+            path = compile_library(source_path, verify)
+        except Exception as e:
+            print(f"{source_path}: {e}", file=sys.stderr)
+            failed = True
+            continue
+
+        theorems = read_artifact(path)["theorems"]
+        print(f"{source_path} -> {path} ({len(theorems)} theorems)")
+        if verify:
+            for name, theorem in theorems.items():
+                if theorem["status"] != "proven":
+                    print(f"  {name}: {theorem['status']}")
+                    failed = True
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,338 @@
+#!/usr/bin/env python3
+"""
+Proof Checker - Language Server
+
+Speaks the Language Server Protocol over stdio (JSON-RPC with
+Content-Length framing) for .proof files. Every open document is checked
+by one warm C++ engine (`prover --serve`, see native.py) in its own
+session, so an edit only re-solves the steps whose dependencies changed.
+
+Diagnostics published per document:
+    parse errors        Error, at the offending token
+    disproven steps     Error, with the counterexample
+    unknown steps       Warning
+    non-exhaustive      Warning, on the cases block
+    proven steps        Hint (with the facts the step depends on)
+
+Checks run on a background thread. Documents are synced in full, and only
+the newest version of a document is ever checked: versions superseded
+before the engine picks them up are never sent, and an edit cancels the
+check still running for the previous version.
+
+Usage:
+    python lsp_server.py [--prover path/to/prover]
+"""
+
+import json
+import os
+import sys
+import threading
+from urllib.parse import unquote, urlparse
+
+from parser import Lexer, Parser, ParseError
+from native import NativeProver, EngineError
+from jobs import CancelToken
+
+
+# LSP DiagnosticSeverity
+ERROR = 1
+WARNING = 2
+INFORMATION = 3
+HINT = 4
+
+# JSON-RPC error codes
+METHOD_NOT_FOUND = -32601
+INVALID_REQUEST = -32600
+
+
+def read_message(stream):
+    """Read one JSON-RPC message; returns None at end of input."""
+    length = None
+    while True:
+        header = stream.readline()
+        if not header:
+            return None
+        header = header.decode("ascii").strip()
+        if not header:
+            break
+        name, _, value = header.partition(":")
+        if name.strip().lower() == "content-length":
+            length = int(value.strip())
+    if length is None:
+        return None
+    return json.loads(stream.read(length).decode("utf-8"))
+
+
+def write_message(stream, message: dict):
+    body = json.dumps(message).encode("utf-8")
+    stream.write(f"Content-Length: {len(body)}\r\n\r\n".encode("ascii") + body)
+    stream.flush()
+
+
+def uri_to_path(uri: str) -> str:
+    parsed = urlparse(uri)
+    if parsed.scheme != "file":
+        return None
+    return unquote(parsed.path)
+
+
+def line_range(lines, line: int, col: int = None) -> dict:
+    """Range covering a 1-based source line, from col (1-based) if given."""
+    index = max(line - 1, 0)
+    text = lines[index] if index < len(lines) else ""
+    if col is not None:
+        start = max(col - 1, 0)
+    else:
+        start = len(text) - len(text.lstrip())
+    end = max(len(text.rstrip()), start + 1)
+    return {"start": {"line": index, "character": start},
+            "end": {"line": index, "character": end}}
+
+
+def diagnostic(lines, line, message: str, severity: int, col: int = None) -> dict:
+    return {
+        "range": line_range(lines, line or 1, col),
+        "severity": severity,
+        "source": "proofchecker",
+        "message": message,
+    }
+
+
+def format_model(model: dict) -> str:
+    return ", ".join(f"{name} = {value}" for name, value in sorted(model.items()))
+
+
+def parse_diagnostics(error: ParseError, lines) -> list:
+    """One diagnostic per error collected by the parser."""
+    errors = getattr(error, "errors", None) or [error]
+    return [diagnostic(lines, e.line, e.detail, ERROR, e.col) for e in errors]
+
+
+def _step_diagnostic(lines, line, result: dict, what: str) -> dict:
+    status = result.get("status")
+    if status == "proven":
+        message = f"{what} proven"
+        if result.get("depends_on"):
+            message += " from " + ", ".join(result["depends_on"])
+        return diagnostic(lines, line, message, HINT)
+    if status == "disproven":
+        message = f"{what} does not follow"
+        if result.get("model"):
+            message += "; counterexample: " + format_model(result["model"])
+        return diagnostic(lines, line, message, ERROR)
+    if status == "unknown":
+        return diagnostic(lines, line, f"{what} could not be decided", WARNING)
+    return diagnostic(lines, line, result.get("error", f"{what} could not be checked"), ERROR)
+
+
+def result_diagnostics(ast: dict, result: dict, lines) -> list:
+    """Map a prover response back onto the source lines of its AST."""
+    if result.get("status") == "error":
+        return [diagnostic(lines, ast.get("claim_line"), result.get("error", "Error"), ERROR)]
+
+    diagnostics = []
+    steps = ast.get("steps", [])
+    for step_result in result.get("step_results", []):
+        index = step_result.get("step", 0) - 1
+        if not 0 <= index < len(steps):
+            continue
+        step = steps[index]
+
+        if step.get("type") == "cases":
+            if step_result.get("status") == "non-exhaustive":
+                diagnostics.append(diagnostic(
+                    lines, step.get("line"),
+                    step_result.get("message", "Cases may not cover all possibilities"),
+                    WARNING))
+            for case_result in step_result.get("case_results", []):
+                case_index = case_result.get("case", 0) - 1
+                if not 0 <= case_index < len(step["cases"]):
+                    continue
+                case_steps = step["cases"][case_index].get("steps", [])
+                for r in case_result.get("step_results", []):
+                    k = r.get("step", 0) - 1
+                    if 0 <= k < len(case_steps):
+                        diagnostics.append(
+                            _step_diagnostic(lines, case_steps[k].get("line"), r, "Step"))
+            continue
+
+        diagnostics.append(_step_diagnostic(lines, step.get("line"), step_result, "Step"))
+
+    diagnostics.append(_step_diagnostic(lines, ast.get("claim_line"), result, "Claim"))
+    return diagnostics
+
+
+class ProofServer:
+    """LSP state: open documents and the background checker."""
+
+    def __init__(self, engine: NativeProver, output):
+        self.engine = engine
+        self.output = output
+        self.documents = {}  # uri -> (version, text)
+        self.pending = {}  # uri -> version waiting to be checked
+        self.running = {}  # uri -> (version, CancelToken) being checked
+        self.shutdown_requested = False
+        self._write_lock = threading.Lock()
+        self._cond = threading.Condition()
+        self._stopped = False
+        self._worker = threading.Thread(target=self._check_loop, daemon=True)
+        self._worker.start()
+
+    # -- transport --------------------------------------------------------
+
+    def send(self, message: dict):
+        message["jsonrpc"] = "2.0"
+        with self._write_lock:
+            write_message(self.output, message)
+
+    def publish(self, uri: str, diagnostics: list, version: int = None):
+        params = {"uri": uri, "diagnostics": diagnostics}
+        if version is not None:
+            params["version"] = version
+        self.send({"method": "textDocument/publishDiagnostics", "params": params})
+
+    # -- checking ---------------------------------------------------------
+
+    def is_current(self, uri: str, version) -> bool:
+        with self._cond:
+            doc = self.documents.get(uri)
+            return doc is not None and doc[0] == version
+
+    def check_document(self, uri: str, version, text: str, cancel: CancelToken = None):
+        """Parse and check one document version; returns diagnostics, or
+        None if the version went stale before the check finished."""
+        lines = text.split("\n")
+        path = uri_to_path(uri)
+        base_path = os.path.dirname(path) if path else None
+        try:
+            parser = Parser(Lexer(text).tokenize(), base_path)
+            if path:
+                parser.imported_files.add(os.path.abspath(path))
+            ast = parser.parse()
+        except ParseError as e:
+            return parse_diagnostics(e, lines)
+
+        if not self.is_current(uri, version):
+            return None
+        try:
+            result = self.engine.check(ast, session=uri, cancel=cancel)
+        except EngineError as e:
+            return [diagnostic(lines, 1, str(e), ERROR)]
+        if result.get("status") == "cancelled":
+            return None
+        return result_diagnostics(ast, result, lines)
+
+    def schedule(self, uri: str, version, text: str):
+        with self._cond:
+            self.documents[uri] = (version, text)
+            # A newer version replaces any version still waiting and
+            # cancels the one being checked
+            self.pending[uri] = version
+            running = self.running.get(uri)
+            self._cond.notify()
+        if running and running[0] != version:
+            running[1].cancel()
+
+    def _check_loop(self):
+        while True:
+            with self._cond:
+                while not self.pending and not self._stopped:
+                    self._cond.wait()
+                if self._stopped:
+                    return
+                uri, version = next(iter(self.pending.items()))
+                del self.pending[uri]
+                doc = self.documents.get(uri)
+                if doc is None or doc[0] != version:
+                    continue
+                text = doc[1]
+                token = CancelToken()
+                self.running[uri] = (version, token)
+
+            diagnostics = self.check_document(uri, version, text, token)
+            with self._cond:
+                del self.running[uri]
+            if diagnostics is not None and self.is_current(uri, version):
+                self.publish(uri, diagnostics, version)
+
+    def stop(self):
+        with self._cond:
+            self._stopped = True
+            self._cond.notify()
+        self._worker.join()
+        self.engine.close()
+
+    # -- protocol ---------------------------------------------------------
+
+    def handle(self, message: dict):
+        """Dispatch one request or notification. Returns False on exit."""
+        method = message.get("method")
+        params = message.get("params") or {}
+        msg_id = message.get("id")
+
+        if method == "initialize":
+            self.send({"id": msg_id, "result": {
+                "capabilities": {
+                    "textDocumentSync": {"openClose": True, "change": 1},
+                },
+                "serverInfo": {"name": "proofchecker"},
+            }})
+        elif method == "shutdown":
+            self.shutdown_requested = True
+            self.send({"id": msg_id, "result": None})
+        elif method == "exit":
+            return False
+        elif method == "textDocument/didOpen":
+            doc = params["textDocument"]
+            self.schedule(doc["uri"], doc.get("version"), doc["text"])
+        elif method == "textDocument/didChange":
+            doc = params["textDocument"]
+            changes = params.get("contentChanges", [])
+            if changes:
+                # Full sync: the last change holds the whole document
+                self.schedule(doc["uri"], doc.get("version"), changes[-1]["text"])
+        elif method == "textDocument/didClose":
+            uri = params["textDocument"]["uri"]
+            with self._cond:
+                self.documents.pop(uri, None)
+                self.pending.pop(uri, None)
+                running = self.running.get(uri)
+            if running:
+                running[1].cancel()
+            self.publish(uri, [])
+        elif msg_id is not None and method is not None:
+            self.send({"id": msg_id, "error": {
+                "code": METHOD_NOT_FOUND,
+                "message": f"Method not found: {method}",
+            }})
+        elif method is None and msg_id is not None:
+            self.send({"id": msg_id, "error": {
+                "code": INVALID_REQUEST,
+                "message": "Missing method",
+            }})
+        # Other notifications (initialized, $/cancelRequest, ...) need no reply
+        return True
+
+
+def main():
+    args = sys.argv[1:]
+    binary = None
+    if args[:1] == ["--prover"] and len(args) > 1:
+        binary = args[1]
+    elif args:
+        print("Usage: python lsp_server.py [--prover path/to/prover]", file=sys.stderr)
+        sys.exit(2)
+
+    server = ProofServer(NativeProver(binary), sys.stdout.buffer)
+    try:
+        while True:
+            message = read_message(sys.stdin.buffer)
+            if message is None or not server.handle(message):
+                break
+    finally:
+        server.stop()
+    sys.exit(0 if server.shutdown_requested else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""
+Proof Checker - Native Engine Client
+
+Drives a long-running C++ prover (`cpp/build/prover --serve`), which reads
+one JSON request per line and answers with one JSON response per line.
+Keeping the process alive keeps its theorem cache and per-document
+sessions warm, so re-checking an edited proof only re-solves the
+obligations whose dependencies changed.
+
+Usage:
+    engine = NativeProver()
+    result = engine.check(ast, session="file:///path/to/proof.proof")
+    engine.close()
+"""
+
+import itertools
+import json
+import os
+import subprocess
+import threading
+
+
+def default_binary() -> str:
+    """Location of the C++ prover: $PROOFCHECKER_PROVER or cpp/build/prover."""
+    override = os.environ.get("PROOFCHECKER_PROVER")
+    if override:
+        return override
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    return os.path.join(root, "cpp", "build", "prover")
+
+
+class EngineError(Exception):
+    """The native prover could not be started or stopped responding."""
+    pass
+
+
+class _Call:
+    """A request waiting for its response."""
+
+    def __init__(self, on_step):
+        self.on_step = on_step
+        self.response = None
+        self.done = threading.Event()
+
+
+class NativeProver:
+    """A persistent `prover --serve` process.
+
+    check() may be called from several threads at once; responses are
+    matched to requests by id on a reader thread. The engine solves one
+    request at a time, but later requests can cancel earlier ones (a
+    request for a session supersedes that session's earlier requests). If
+    the process dies, pending checks raise EngineError and it is restarted
+    on the next request (its sessions are lost, so that request is checked
+    from scratch).
+    """
+
+    def __init__(self, binary: str = None, args=()):
+        self.binary = binary or default_binary()
+        self.args = list(args)
+        self._proc = None
+        self._calls = {}  # id -> _Call, for the current process
+        self._lock = threading.Lock()
+        self._ids = itertools.count(1)
+
+    def _start(self):
+        # Caller holds the lock
+        if not os.path.exists(self.binary):
+            raise EngineError(f"C++ prover binary not found at {self.binary}")
+        self._proc = subprocess.Popen(
+            [self.binary, "--serve"] + self.args,
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            text=True,
+            bufsize=1,
+        )
+        self._calls = {}
+        reader = threading.Thread(target=self._read, args=(self._proc, self._calls),
+                                  daemon=True)
+        reader.start()
+
+    def _read(self, proc, calls):
+        for line in proc.stdout:
+            message = json.loads(line)
+            with self._lock:
+                call = calls.get(message.get("id"))
+                if call is not None and message.get("event") != "step":
+                    del calls[message["id"]]
+            if call is None:
+                continue
+            if message.get("event") == "step":
+                if call.on_step:
+                    call.on_step(message["step_result"])
+                continue
+            call.response = message
+            call.done.set()
+
+        # The process exited: fail everything still waiting on it
+        with self._lock:
+            orphaned = list(calls.values())
+            calls.clear()
+        for call in orphaned:
+            call.done.set()
+
+    def _send(self, message: dict):
+        # Caller holds the lock
+        self._proc.stdin.write(json.dumps(message) + "\n")
+        self._proc.stdin.flush()
+
+    def check(self, request: dict, session: str = None, on_step=None,
+              cancel=None) -> dict:
+        """Check a proof AST and return the engine's response.
+
+        Args:
+            request: AST as produced by parser.parse()
+            session: Document id; requests sharing a session are re-checked
+                     incrementally
+            on_step: Optional callback, called with each step_results entry
+                     as soon as the engine has checked that step
+            cancel: Optional token with add_callback(fn) (see
+                    jobs.CancelToken); cancelling it interrupts the check,
+                    which then returns status "cancelled"
+        """
+        request = dict(request)
+        if session is not None:
+            request["session"] = session
+        if on_step is not None:
+            request["stream"] = True
+
+        call = _Call(on_step)
+        with self._lock:
+            if self._proc is None or self._proc.poll() is not None:
+                self._start()
+            request_id = next(self._ids)
+            request["id"] = request_id
+            self._calls[request_id] = call
+            try:
+                self._send(request)
+            except (BrokenPipeError, OSError) as e:
+                self._calls.pop(request_id, None)
+                self._proc = None
+                raise EngineError(f"C++ prover stopped: {e}")
+            proc = self._proc
+
+        if cancel is not None:
+            cancel.add_callback(lambda: self._cancel(proc, request_id))
+
+        call.done.wait()
+        if call.response is None:
+            raise EngineError("C++ prover exited unexpectedly")
+        response = call.response
+        response.pop("id", None)
+        return response
+
+    def _cancel(self, proc, request_id):
+        with self._lock:
+            if self._proc is proc and request_id in self._calls:
+                try:
+                    self._send({"cancel": request_id})
+                except (BrokenPipeError, OSError):
+                    pass
+
+    def close(self):
+        """Stop the engine process."""
+        with self._lock:
+            proc, self._proc = self._proc, None
+        if proc is not None:
+            proc.stdin.close()
+            try:
+                proc.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                proc.kill()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
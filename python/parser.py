@@ -14,6 +14,7 @@ Syntax:
     let x in Z+          Positive variant (adds x > 0)
     theorem name: ...    (or: lemma)
     apply theorem_name   (or: use, using, by)
+    apply name(t1, t2)   Instantiate the theorem's free variables in order
     cases: / case:       (or: when, whenever)
     import "file.proof"
 
@@ -50,6 +51,7 @@ class ParseError(Exception):
     def __init__(self, message: str, line: int = None, col: int = None):
         self.line = line
         self.col = col
+        self.detail = message  # Message without the location prefix
         if line is not None:
             loc = f"line {line}"
             if col is not None:
@@ -221,14 +223,16 @@ class Parser:
         self.pos = 0
         self.assumptions = []
         self.steps = []  # Intermediate proof steps (have/assert)
+        self.premises = []  # Applied theorems -> {name, formula}
         self.claim = None
+        self.claim_line = None
         self.variables = set()
         self.var_types = {}  # Variable name -> type ('Int' or 'Real')
         self.theorems = {}  # Theorem name -> {assumptions, conclusion}
         self.current_theorem = None  # For parsing theorem blocks
         self.base_path = base_path or "."  # Base path for relative imports
         self.imported_files = set()  # Track imported files to prevent cycles
-        self.errors = []  # Collect errors for recovery mode
+        self.errors = []  # Collected ParseErrors for recovery mode
     
     def current(self) -> Token:
         return self.tokens[self.pos] if self.pos < len(self.tokens) else self.tokens[-1]
@@ -264,7 +268,7 @@ class Parser:
                 self.parse_statement()
             except ParseError as e:
                 # Collect error and try to recover
-                self.errors.append(str(e))
+                self.errors.append(e)
                 # Skip to next line to recover
                 self.recover_to_next_statement()
             self.skip_newlines()
@@ -272,7 +276,9 @@ class Parser:
         # Report all collected errors
         if self.errors:
             error_msg = f"Found {len(self.errors)} error(s):\n" + "\n".join(f"  - {e}" for e in self.errors)
-            raise ParseError(error_msg)
+            error = ParseError(error_msg)
+            error.errors = self.errors
+            raise error
         
         if self.claim is None:
             raise ParseError("No 'prove' statement found")
@@ -282,14 +288,25 @@ class Parser:
             "var_types": self.var_types,
             "assumptions": self.assumptions,
             "steps": self.steps,
-            "claim": self.claim
+            "claim": self.claim,
+            "claim_line": self.claim_line
         }
         
+        if self.premises:
+            result["premises"] = self.premises
+        
         if self.theorems:
             result["theorems"] = self.theorems
             
         return result
     
+    def parse_library(self):
+        """Parse a library file: statements up to EOF, no claim required."""
+        self.skip_newlines()
+        while not self.match('EOF'):
+            self.parse_statement()
+            self.skip_newlines()
+    
     def recover_to_next_statement(self):
         """Skip tokens until we find the start of a new statement."""
         statement_starters = {'ASSUME', 'PROVE', 'HAVE', 'ASSERT', 'LET', 'THEOREM', 'APPLY', 'IMPORT', 'CASES', 'EOF'}
@@ -313,11 +330,12 @@ class Parser:
         elif tok.type == 'PROVE':
             self.advance()
             self.claim = self.parse_formula()
+            self.claim_line = tok.line
         elif tok.type in ('HAVE', 'ASSERT'):
             # Intermediate proof step
             self.advance()
             formula = self.parse_formula()
-            self.steps.append({"formula": formula})
+            self.steps.append({"formula": formula, "line": tok.line})
         elif tok.type == 'LET':
             self.advance()
             name = self.expect('IDENT').value
@@ -390,19 +408,47 @@ class Parser:
             theorem_name = self.expect('IDENT').value
             if theorem_name not in self.theorems:
                 raise ParseError(f"Unknown theorem: {theorem_name}", tok.line, tok.col)
-            # Add the theorem's implication as an assumption
             theorem = self.theorems[theorem_name]
+            
+            # Optional explicit instantiation: apply name(t1, t2, ...)
+            inst_args = None
+            if self.match('LPAREN'):
+                self.advance()
+                inst_args = [self.parse_expr()]
+                while self.match('COMMA'):
+                    self.advance()
+                    inst_args.append(self.parse_expr())
+                self.expect('RPAREN')
+            
             # Create: (all assumptions) => conclusion
             if theorem["assumptions"]:
-                impl = {
+                formula = {
                     "type": "implies",
                     "lhs": {"type": "and", "args": theorem["assumptions"]} if len(theorem["assumptions"]) > 1 else theorem["assumptions"][0],
                     "rhs": theorem["conclusion"]
                 }
-                self.assumptions.append(impl)
             else:
-                # No assumptions, just add the conclusion
-                self.assumptions.append(theorem["conclusion"])
+                # No assumptions, just the conclusion
+                formula = theorem["conclusion"]
+            if inst_args is not None:
+                # Substitute the given terms for the theorem's free variables
+                params = theorem_params(theorem)
+                if len(inst_args) != len(params):
+                    raise ParseError(f"Theorem '{theorem_name}' takes {len(params)} argument(s) ({', '.join(params)}), got {len(inst_args)}", tok.line, tok.col)
+                formula = {
+                    "type": "instantiate",
+                    "theorem": theorem_name,
+                    "vars": params,
+                    "args": inst_args,
+                    "body": formula
+                }
+            if self.current_theorem is not None:
+                # Inside a theorem body the implication is a plain assumption
+                self.assumptions.append(formula)
+            else:
+                # Top-level applications are premises; the prover decides
+                # which of them are relevant enough to send to the solver
+                self.premises.append({"name": theorem_name, "formula": formula})
         elif tok.type == 'IMPORT':
             self.parse_import()
         elif tok.type == 'CASES':
@@ -421,10 +467,13 @@ class Parser:
         # Save current state
         old_assumptions = self.assumptions
         old_claim = self.claim
+        old_claim_line = self.claim_line
+        old_theorem = self.current_theorem
         
         # Parse theorem body
         self.assumptions = []
         self.claim = None
+        self.current_theorem = theorem_name
         
         # Parse statements until we hit a 'prove'
         while not self.match('EOF') and self.claim is None:
@@ -443,6 +492,8 @@ class Parser:
         # Restore state
         self.assumptions = old_assumptions
         self.claim = old_claim
+        self.claim_line = old_claim_line
+        self.current_theorem = old_theorem
     
     def parse_import(self):
         """Parse an import statement and merge imported theorems."""
@@ -457,7 +508,7 @@ class Parser:
         # Resolve relative path from base_path
         if not os.path.isabs(import_path):
             import_path = os.path.join(self.base_path, import_path)
-        import_path = os.path.normpath(import_path)
+        import_path = os.path.abspath(import_path)
         
         # Check for import cycles
         if import_path in self.imported_files:
@@ -470,6 +521,14 @@ class Parser:
             raise ParseError(f"Import file not found: {import_path}", path_tok.line, path_tok.col)
         
         try:
+            # Use the precompiled artifact if none of its sources changed
+            from library import load_library, theorem_var_types
+            library = load_library(import_path)
+            if library is not None:
+                self.imported_files.update(library["sources"])
+                self.theorems.update(library["theorems"])
+                return
+            
             with open(import_path, 'r') as f:
                 source = f.read()
             
@@ -478,15 +537,14 @@ class Parser:
             tokens = lexer.tokenize()
             import_parser = Parser(tokens, os.path.dirname(import_path))
             import_parser.imported_files = self.imported_files  # Share import tracking
+            import_parser.parse_library()
             
-            # Parse as a library (no claim required)
-            import_parser.skip_newlines()
-            while not import_parser.match('EOF'):
-                import_parser.parse_statement()
-                import_parser.skip_newlines()
-            
-            # Merge imported theorems
-            self.theorems.update(import_parser.theorems)
+            # Merge imported theorems, each with the library's types for its
+            # variables; this file's own var_types are left alone
+            for name, theorem in import_parser.theorems.items():
+                self.theorems[name] = dict(
+                    theorem,
+                    var_types=theorem_var_types(theorem, import_parser.var_types))
             
         except Exception as e:
             raise ParseError(f"Error importing {import_path}: {e}", path_tok.line, path_tok.col)
@@ -503,14 +561,14 @@ class Parser:
                 case x = 0:
                     have x * x = 0
         """
-        self.advance()  # consume 'cases'
+        cases_tok = self.advance()  # consume 'cases'
         self.expect('COLON')
         self.skip_newlines()
         
         cases = []
         
         while self.match('CASE'):
-            self.advance()  # consume 'case'
+            case_tok = self.advance()  # consume 'case'
             condition = self.parse_formula()
             self.expect('COLON')
             self.skip_newlines()
@@ -519,9 +577,9 @@ class Parser:
             case_steps = []
             while not self.match('CASE', 'EOF', 'PROVE', 'ASSUME', 'LET', 'THEOREM', 'IMPORT', 'CASES'):
                 if self.match('HAVE', 'ASSERT'):
-                    self.advance()
+                    step_tok = self.advance()
                     formula = self.parse_formula()
-                    case_steps.append({"formula": formula})
+                    case_steps.append({"formula": formula, "line": step_tok.line})
                     self.skip_newlines()
                 elif self.match('NEWLINE'):
                     self.advance()
@@ -530,7 +588,8 @@ class Parser:
             
             cases.append({
                 "condition": condition,
-                "steps": case_steps
+                "steps": case_steps,
+                "line": case_tok.line
             })
         
         if not cases:
@@ -539,7 +598,8 @@ class Parser:
         # Store cases as a special step type
         self.steps.append({
             "type": "cases",
-            "cases": cases
+            "cases": cases,
+            "line": cases_tok.line
         })
     
     def parse_formula(self) -> Dict[str, Any]:
@@ -762,6 +822,42 @@ class Parser:
         raise ParseError(f"Unexpected token: {tok.type} ({tok.value!r})", tok.line, tok.col)
 
 
+def theorem_params(theorem: Dict[str, Any]) -> List[str]:
+    """Free variables of a theorem in order of first occurrence.
+    
+    These are the parameters bound positionally by `apply name(t1, t2)`:
+    assumptions are scanned before the conclusion, and variables bound by
+    a quantifier inside the theorem are not parameters.
+    """
+    params = []
+    
+    def walk(node, bound):
+        if isinstance(node, list):
+            for item in node:
+                walk(item, bound)
+            return
+        if not isinstance(node, dict):
+            return
+        ty = node.get("type")
+        if ty == "var":
+            name = node.get("name")
+            if name not in bound and name not in params:
+                params.append(name)
+        elif ty in ("forall", "exists"):
+            walk(node.get("body"), bound | set(node.get("vars", [])))
+        elif ty == "instantiate":
+            walk(node.get("args"), bound)
+            walk(node.get("body"), bound | set(node.get("vars", [])))
+        else:
+            for key in ("lhs", "rhs", "arg", "args", "base", "exp"):
+                if key in node:
+                    walk(node[key], bound)
+    
+    walk(theorem.get("assumptions", []), set())
+    walk(theorem.get("conclusion"), set())
+    return params
+
+
 def parse(source: str, base_path: str = None) -> Dict[str, Any]:
     """Parse proof DSL source into JSON AST."""
     lexer = Lexer(source)
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""
+Proof Checker - Performance Regression Gate
+
+Checks a fixed corpus with the C++ prover and compares each proof's median
+and p95 latency against a stored baseline. Fails, with a per-proof report,
+if any proof got slower than the tolerance allows or its status changed.
+
+The corpus is every examples/*.proof, every stdlib theorem (proven from its
+own assumptions) and the corpus.py families at GATE_SIZES. Each proof is
+checked once to warm the engine's caches, then timed `--repeat` times on a
+single `prover --serve --no-cache` process. Proofs that regress are measured
+a second time before the gate fails, so a one-off stall does not fail it.
+
+A proof regresses if its median exceeds
+
+    baseline * (1 + tolerance) + slack_ms
+
+or its p95 exceeds the same with p95_tolerance, which is looser because the
+tail of a few samples is noisier. The slack keeps millisecond-scale proofs
+from failing on scheduler noise. Baselines are machine-specific: record
+them with --update on the machine that runs the gate.
+
+Usage:
+    python perf_gate.py --prover cpp/build/prover --baseline cpp/perf_baseline.json
+    python perf_gate.py --prover cpp/build/prover --baseline cpp/perf_baseline.json --update
+"""
+
+import argparse
+import glob
+import json
+import os
+import sys
+import tempfile
+import time
+
+from corpus import write_corpus
+from native import NativeProver, EngineError
+from parser import Lexer, Parser, parse_file
+
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Family -> sizes checked by the gate; kept small enough to run in seconds
+GATE_SIZES = {
+    "chain": [16, 256],
+    "sum": [16, 256],
+    "product": [4, 16],
+    "cases": [2, 6],
+    "apply": [4, 64],
+    "minmax": [8, 128],
+    "quantifier": [2, 4],
+}
+
+
+def corpus(work_dir):
+    """(name, request, expected status or None) for every proof in the gate."""
+    proofs = []
+    for path in sorted(glob.glob(os.path.join(ROOT, "examples", "*.proof"))):
+        name = os.path.splitext(os.path.basename(path))[0]
+        proofs.append((f"examples/{name}", parse_file(path), None))
+
+    stdlib = os.path.join(ROOT, "stdlib", "arithmetic.proof")
+    with open(stdlib) as f:
+        parser = Parser(Lexer(f.read()).tokenize(), os.path.dirname(stdlib))
+    parser.parse_library()
+    for name, theorem in parser.theorems.items():
+        request = {"vars": [], "var_types": parser.var_types,
+                   "assumptions": theorem["assumptions"],
+                   "claim": theorem["conclusion"]}
+        proofs.append((f"stdlib/{name}", request, None))
+
+    for family, sizes in GATE_SIZES.items():
+        for entry in write_corpus(work_dir, [family], sizes, disproven=True):
+            with open(os.path.join(work_dir, entry["request"])) as f:
+                request = json.load(f)
+            proofs.append((f"corpus/{entry['name']}", request, entry["expected"]))
+    return proofs
+
+
+def percentile(samples, p):
+    """Nearest-rank percentile of a non-empty list."""
+    ordered = sorted(samples)
+    rank = max(1, -(-len(ordered) * p // 100))
+    return ordered[int(rank) - 1]
+
+
+def measure(engine, request, repeat):
+    """Status and latency samples (ms) of one proof."""
+    status = engine.check(request)["status"]
+    samples = []
+    for _ in range(repeat):
+        start = time.perf_counter()
+        result = engine.check(request)
+        samples.append((time.perf_counter() - start) * 1000)
+        status = result["status"]
+    return status, samples
+
+
+def run(prover, repeat, names=None):
+    """Measure the corpus, or the proofs in names: name -> {status,
+    median_ms, p95_ms}."""
+    results = {}
+    engine = NativeProver(prover, args=["--no-cache"])
+    try:
+        with tempfile.TemporaryDirectory() as work_dir:
+            for name, request, expected in corpus(work_dir):
+                if names is not None and name not in names:
+                    continue
+                status, samples = measure(engine, request, repeat)
+                if expected is not None and status != expected:
+                    print(f"warning: {name} is {status}, expected {expected}",
+                          file=sys.stderr)
+                results[name] = {
+                    "status": status,
+                    "median_ms": round(percentile(samples, 50), 3),
+                    "p95_ms": round(percentile(samples, 95), 3),
+                }
+    finally:
+        engine.close()
+    return results
+
+
+def compare(baseline, current, tolerances, slack_ms):
+    """Report lines for every proof, and the names of those that regressed."""
+    regressed = set()
+    lines = [f"{'proof':32} {'median ms':>21} {'p95 ms':>21}  verdict"]
+    for name in sorted(set(baseline) | set(current)):
+        base, now = baseline.get(name), current.get(name)
+        if base is None:
+            lines.append(f"{name:32} {'':>21} {'':>21}  new (not in baseline)")
+            continue
+        if now is None:
+            lines.append(f"{name:32} {'':>21} {'':>21}  missing from corpus")
+            regressed.add(name)
+            continue
+
+        verdicts = []
+        for key, tolerance in tolerances.items():
+            limit = base[key] * (1 + tolerance) + slack_ms
+            if now[key] > limit:
+                verdicts.append(f"{key[:-3]} over {limit:.1f}")
+        if now["status"] != base["status"]:
+            verdicts.append(f"status {base['status']} -> {now['status']}")
+        if verdicts:
+            regressed.add(name)
+
+        def cell(key):
+            change = (now[key] / base[key] - 1) * 100 if base[key] else 0.0
+            return f"{base[key]:7.1f} -> {now[key]:7.1f} {change:+4.0f}%"
+
+        lines.append(f"{name:32} {cell('median_ms'):>21} {cell('p95_ms'):>21}  "
+                     + ("; ".join(verdicts) if verdicts else "ok"))
+    return lines, regressed
+
+
+def main():
+    arg_parser = argparse.ArgumentParser(
+        description="Compare prover latency on a fixed corpus to a baseline")
+    arg_parser.add_argument("--prover", required=True,
+                            help="Path to the C++ prover binary")
+    arg_parser.add_argument("--baseline", required=True,
+                            help="Baseline JSON file")
+    arg_parser.add_argument("--repeat", type=int, default=20,
+                            help="Timed checks per proof (default: 20)")
+    arg_parser.add_argument("--tolerance", type=float, default=0.5,
+                            help="Allowed relative median slowdown (default: 0.5)")
+    arg_parser.add_argument("--p95-tolerance", type=float, default=1.0,
+                            help="Allowed relative p95 slowdown (default: 1.0)")
+    arg_parser.add_argument("--slack-ms", type=float, default=5.0,
+                            help="Allowed absolute slowdown in ms (default: 5)")
+    arg_parser.add_argument("--update", action="store_true",
+                            help="Write the measurements as the new baseline")
+    args = arg_parser.parse_args()
+    if args.repeat < 1:
+        arg_parser.error("--repeat must be positive")
+
+    try:
+        current = run(args.prover, args.repeat)
+    except EngineError as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    if args.update:
+        with open(args.baseline, "w") as f:
+            json.dump({"repeat": args.repeat, "proofs": current}, f,
+                      indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Wrote baseline for {len(current)} proofs to {args.baseline}")
+        return
+
+    try:
+        with open(args.baseline) as f:
+            baseline = json.load(f)["proofs"]
+    except (OSError, ValueError, KeyError) as e:
+        print(f"Cannot read baseline {args.baseline}: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    tolerances = {"median_ms": args.tolerance, "p95_ms": args.p95_tolerance}
+    lines, regressed = compare(baseline, current, tolerances, args.slack_ms)
+    if regressed:
+        print(f"Re-measuring {len(regressed)} regressed proof(s)", file=sys.stderr)
+        current.update(run(args.prover, args.repeat, regressed))
+        lines, regressed = compare(baseline, current, tolerances, args.slack_ms)
+    failed = bool(regressed)
+    print("\n".join(lines))
+    print(f"\n{'FAILED' if failed else 'OK'}: {len(current)} proofs, "
+          f"tolerance {args.tolerance:.0%} (p95 {args.p95_tolerance:.0%}) "
+          f"+ {args.slack_ms:g} ms")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
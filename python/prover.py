@@ -5,10 +5,13 @@ Supports logical connectives, quantifiers, and rich arithmetic.
 
 import json
 import sys
+import time
+from contextlib import contextmanager
 from z3 import (
     Real, RealVal, Int, IntVal, If, Solver, Not, And, Or, Implies, ForAll, Exists,
-    sat, unsat, unknown
+    sat, unsat, unknown, is_algebraic_value, is_rational_value
 )
+from z3.z3core import Z3_get_estimated_alloc_size
 
 
 class ProofError(Exception):
@@ -149,6 +152,7 @@ def formula_to_z3(f, env, var_types=None):
     - implies: implication (lhs => rhs)
     - forall: universal quantifier
     - exists: existential quantifier
+    - instantiate: theorem body with terms substituted for its variables
     """
     if var_types is None:
         var_types = {}
@@ -205,6 +209,19 @@ def formula_to_z3(f, env, var_types=None):
         rhs = formula_to_z3(f["rhs"], env, var_types)
         return Implies(lhs, rhs)
 
+    if ty == "instantiate":
+        names = f.get("vars", [])
+        args = f.get("args", [])
+        if "body" not in f:
+            raise FormulaError("Instantiate formula missing 'body' field")
+        if len(names) != len(args):
+            raise FormulaError(
+                f"Instantiation of {f.get('theorem', 'theorem')} expects "
+                f"{len(names)} argument(s), got {len(args)}")
+        # Ground instance: no quantifier is handed to the solver
+        ground = substitute(f["body"], dict(zip(names, args)))
+        return formula_to_z3(ground, env, var_types)
+
     if ty == "forall":
         var_names = f.get("vars", [])
         if not var_names:
@@ -248,16 +265,270 @@ def formula_to_z3(f, env, var_types=None):
     raise FormulaError(f"Unknown formula type: {ty}")
 
 
-def format_counterexample(model, env):
-    """Format a Z3 model as a human-readable counterexample."""
-    lines = ["Counterexample found:"]
-    for name, var in sorted(env.items()):
+def fresh_name(name, avoid):
+    """Return name_1, name_2, ... : the first variant not in avoid."""
+    i = 1
+    while f"{name}_{i}" in avoid:
+        i += 1
+    return f"{name}_{i}"
+
+
+def substitute(f, mapping):
+    """Simultaneously replace free variables in a term or formula.
+    
+    Args:
+        f: Term or formula JSON object
+        mapping: Variable name -> replacement term
+    
+    Substitution is capture-avoiding: a quantifier (or nested
+    instantiation) that binds a variable occurring in a replacement term
+    has that bound variable renamed first.
+    """
+    if isinstance(f, list):
+        return [substitute(item, mapping) for item in f]
+    if not isinstance(f, dict) or not mapping:
+        return f
+
+    ty = f.get("type")
+    if ty == "var":
+        return mapping.get(f.get("name"), f)
+
+    if ty in ("forall", "exists", "instantiate"):
+        result = dict(f)
+        if ty == "instantiate":
+            # Arguments are outside the binder
+            result["args"] = substitute(f.get("args", []), mapping)
+        bound = f.get("vars", [])
+        inner = {k: v for k, v in mapping.items() if k not in bound}
+        if not inner:
+            return result
+        
+        replacement_symbols = set()
+        for term in inner.values():
+            formula_symbols(term, replacement_symbols)
+        avoid = replacement_symbols | formula_symbols(f.get("body")) | set(inner)
+        new_vars = []
+        for v in bound:
+            if v in replacement_symbols:
+                renamed = fresh_name(v, avoid)
+                avoid.add(renamed)
+                inner[v] = {"type": "var", "name": renamed}
+                new_vars.append(renamed)
+            else:
+                new_vars.append(v)
+        result["vars"] = new_vars
+        result["body"] = substitute(f.get("body"), inner)
+        return result
+
+    return {key: substitute(value, mapping) if isinstance(value, (dict, list)) else value
+            for key, value in f.items()}
+
+
+# Number of ranked premises sent to the solver on the first attempt
+DEFAULT_PREMISE_LIMIT = 8
+
+
+def formula_symbols(f, symbols=None):
+    """Collect the variable names occurring in a term or formula JSON object."""
+    if symbols is None:
+        symbols = set()
+    if isinstance(f, dict):
+        if f.get("type") == "var" and "name" in f:
+            symbols.add(f["name"])
+        if f.get("type") == "instantiate":
+            # The theorem's own parameters are replaced by the arguments
+            formula_symbols(f.get("args"), symbols)
+            symbols.update(formula_symbols(f.get("body")) - set(f.get("vars", [])))
+            return symbols
+        for key, value in f.items():
+            if key == "vars" and isinstance(value, list):
+                symbols.update(v for v in value if isinstance(v, str))
+            elif isinstance(value, (dict, list)):
+                formula_symbols(value, symbols)
+    elif isinstance(f, list):
+        for item in f:
+            formula_symbols(item, symbols)
+    return symbols
+
+
+def rank_premises(premises, goal_symbols):
+    """Order premises by relevance to a goal.
+    
+    A premise ranks higher the more symbols it shares with the goal; ties
+    go to the premise with fewer unrelated symbols, then to source order.
+    """
+    scored = []
+    for idx, premise in enumerate(premises):
+        symbols = formula_symbols(premise.get("formula"))
+        overlap = len(symbols & goal_symbols)
+        scored.append((-overlap, len(symbols - goal_symbols), idx, premise))
+    scored.sort(key=lambda item: item[:3])
+    return [item[3] for item in scored]
+
+
+class Timings:
+    """Time one prove() call spent in each phase, in microseconds.
+
+    to_dict() has the same fields as the C++ prover's "timings": decode
+    (measured by the caller), validate, theorems (always 0 here; theorems
+    are verified before prove() is called), translate, solve and model,
+    plus the solve time of each top-level step and of the claim.
+    """
+
+    PHASES = ("decode", "validate", "theorems", "translate", "solve", "model")
+
+    def __init__(self, memory=None):
+        self.phases = dict.fromkeys(self.PHASES, 0)
+        self.steps = []
+        self.claim = 0
+        self.memory = memory  # MemoryUsage sampled after each phase
+
+    @contextmanager
+    def phase(self, name):
+        start = time.perf_counter_ns()
+        try:
+            yield
+        finally:
+            self.phases[name] += (time.perf_counter_ns() - start) // 1000
+            if self.memory is not None:
+                self.memory.sample(name)
+
+    def to_dict(self) -> dict:
+        return {**self.phases, "steps": list(self.steps), "claim": self.claim}
+
+
+def json_size(value) -> int:
+    """Approximate memory held by a decoded JSON value, in bytes."""
+    size = sys.getsizeof(value)
+    if isinstance(value, dict):
+        size += sum(json_size(k) + json_size(v) for k, v in value.items())
+    elif isinstance(value, list):
+        size += sum(json_size(v) for v in value)
+    return size
+
+
+class MemoryUsage:
+    """Memory one prove() call used, in bytes.
+
+    to_dict() has the same fields as the C++ prover's "memory": the size of
+    the request's formulas, the growth in Z3's allocation estimate at its
+    peak after translating and after solving (measured from when the
+    MemoryUsage was created), and the process's RSS high-water mark, which
+    is process-wide. The high-water mark comes from the Unix-only resource
+    module and is None where that is unavailable.
+    """
+
+    def __init__(self):
+        self.ast = 0
+        self.z3_translate = 0
+        self.z3_solve = 0
+        self.z3_start = Z3_get_estimated_alloc_size()
+
+    def sample(self, phase):
+        if phase in ("translate", "solve"):
+            key = "z3_" + phase
+            grown = Z3_get_estimated_alloc_size() - self.z3_start
+            setattr(self, key, max(getattr(self, key), grown))
+
+    def to_dict(self) -> dict:
+        try:
+            import resource
+        except ImportError:
+            peak_rss = None
+        else:
+            # ru_maxrss is in kilobytes on Linux
+            peak_rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024
+        return {"ast": self.ast, "z3_translate": self.z3_translate,
+                "z3_solve": self.z3_solve, "process_peak_rss": peak_rss}
+
+
+def check_goal(s, goal, env, var_types, premises=None, premise_limit=DEFAULT_PREMISE_LIMIT,
+               timings=None):
+    """Check whether the solver's assertions entail goal.
+    
+    Premises are ranked by symbol overlap with the goal and only the top
+    premise_limit are asserted. If that is not enough to prove the goal
+    (sat or unknown), the selection is doubled until every premise is in.
+    
+    Returns the Z3 check result; on sat the model is available from s.
+    Translation and solver time are added to timings, if given.
+    """
+    if timings is None:
+        timings = Timings()
+    ranked = rank_premises(premises or [], formula_symbols(goal))
+    k = min(max(premise_limit, 0), len(ranked))
+    with timings.phase("translate"):
+        goal_z3 = formula_to_z3(goal, env, var_types)
+    while True:
+        s.push()
+        for p in ranked[:k]:
+            with timings.phase("translate"):
+                s.add(formula_to_z3(p["formula"], env, var_types))
+        s.add(Not(goal_z3))
+        with timings.phase("solve"):
+            result = s.check()
+        if result == unsat or k >= len(ranked):
+            return result
+        s.pop()
+        k = min(max(2 * k, 1), len(ranked))
+
+
+def solver_stats(s) -> dict:
+    """Statistics of a solver's checks so far, with keys in snake_case
+    ("rlimit count" becomes "rlimit_count") as in the C++ prover."""
+    st = s.statistics()
+    return {key.replace(" ", "_").replace("-", "_"): st.get_key_value(key)
+            for key in st.keys()}
+
+
+def merge_stats(total: dict, stats: dict) -> dict:
+    """Add one check's statistics to a running total. Memory and maxima
+    are levels, so the total keeps the largest."""
+    for key, value in stats.items():
+        if key == "memory" or "max" in key:
+            total[key] = max(total.get(key, value), value)
+        else:
+            total[key] = total.get(key, 0) + value
+    return total
+
+
+# Values of the "model" and "model_format" request fields
+MODEL_SCOPES = ("none", "relevant", "full")
+MODEL_FORMATS = ("exact", "decimal")
+# Fractional digits of decimal model values (as cpp/prover.hpp)
+MODEL_DECIMAL_DIGITS = 10
+
+
+def format_model(model, env, decimal=False, only=None):
+    """Counterexample values of the variables in env, or of those in only.
+
+    Each variable is evaluated on its own, with model completion. With
+    decimal, real values are written as decimals (ending in "?" where
+    truncated) instead of exact rationals and root-obj algebraic numbers.
+    """
+    out = {}
+    for name, var in env.items():
+        if only is not None and name not in only:
+            continue
         value = model.eval(var, model_completion=True)
+        if decimal and (is_rational_value(value) or is_algebraic_value(value)):
+            out[name] = value.as_decimal(MODEL_DECIMAL_DIGITS)
+        else:
+            out[name] = str(value)
+    return out
+
+
+def format_counterexample(values):
+    """Format format_model() values as a human-readable counterexample."""
+    lines = ["Counterexample found:"]
+    for name, value in sorted(values.items()):
         lines.append(f"  {name} = {value}")
     return "\n".join(lines)
 
 
-def prove(assumptions, claim, declared_vars=None, var_types=None, steps=None):
+def prove(assumptions, claim, declared_vars=None, var_types=None, steps=None,
+          premises=None, premise_limit=DEFAULT_PREMISE_LIMIT, on_step=None,
+          stats=False, memory=False, model="full", model_format="exact"):
     """Attempt to prove that assumptions imply the claim.
     
     Args:
@@ -266,33 +537,92 @@ def prove(assumptions, claim, declared_vars=None, var_types=None, steps=None):
         declared_vars: Optional list of declared variable names
         var_types: Optional dict mapping variable names to types ('Int' or 'Real')
         steps: Optional list of intermediate proof steps to verify
+        premises: Optional list of applied theorems ({name, formula}),
+            selected by relevance for each check
+        premise_limit: Number of premises tried first for each check
+        on_step: Optional callback, called with each step_results entry as
+            soon as that step has been checked
+        stats: Attach Z3 solver statistics to every step, case (summed over
+            its steps) and the claim
+        memory: Report memory use (see MemoryUsage)
+        model: Which variables a counterexample lists: "full" (all),
+            "relevant" (those of the disproven formula) or "none" (no model)
+        model_format: "exact" values, or "decimal" approximations of reals
     
     Returns a dict with:
     - ok: True if proven, False if counterexample found
-    - model: counterexample variable assignments (if ok=False)
+    - model: counterexample variable assignments (if disproven, unless
+      model="none")
     - error: error message (if parsing failed)
     - status: "proven", "disproven", "unknown", or "error"
     - step_results: results for each intermediate step (if steps provided)
+    - timings: microseconds spent per phase (see Timings)
+    - memory: bytes used (if memory=True)
     """
+    usage = None
+    if memory:
+        usage = MemoryUsage()
+        usage.ast = json_size([assumptions, claim, steps, premises])
+    timings = Timings(usage)
+
+    def finish(response):
+        if step_results:
+            response["step_results"] = step_results
+        response["timings"] = timings.to_dict()
+        if usage is not None:
+            response["memory"] = usage.to_dict()
+        return response
+
+    def translate(f, env):
+        with timings.phase("translate"):
+            return formula_to_z3(f, env, var_types)
+
+    def counterexample(s, goal, env):
+        """format_model() of a sat solver per the model options, or None."""
+        if model == "none":
+            return None
+        with timings.phase("model"):
+            only = formula_symbols(goal) if model == "relevant" else None
+            return format_model(s.model(), env, model_format == "decimal", only)
+
+    if model not in MODEL_SCOPES:
+        return {"ok": False, "status": "error",
+                "error": f"Unknown model option '{model}' "
+                         "(expected none, relevant or full)"}
+    if model_format not in MODEL_FORMATS:
+        return {"ok": False, "status": "error",
+                "error": f"Unknown model_format '{model_format}' "
+                         "(expected exact or decimal)"}
+
     try:
-        if var_types is None:
-            var_types = {}
-        if steps is None:
-            steps = []
-            
-        env = {}
-        if declared_vars:
-            for name in declared_vars:
-                if var_types.get(name) == 'Int':
-                    env[name] = Int(name)
-                else:
-                    env[name] = Real(name)
+        with timings.phase("validate"):
+            if var_types is None:
+                var_types = {}
+            if steps is None:
+                steps = []
+
+            env = {}
+            if declared_vars:
+                for name in declared_vars:
+                    if var_types.get(name) == 'Int':
+                        env[name] = Int(name)
+                    else:
+                        env[name] = Real(name)
 
         # Verify intermediate steps first
         step_results = []
+        step_start = 0  # solve time when the current step began
+
+        def record(entry):
+            timings.steps.append(timings.phases["solve"] - step_start)
+            step_results.append(entry)
+            if on_step:
+                on_step(entry)
+
         current_assumptions = list(assumptions)
         
         for i, step in enumerate(steps):
+            step_start = timings.phases["solve"]
             # Handle cases step type
             if step.get("type") == "cases":
                 cases = step.get("cases", [])
@@ -309,128 +639,120 @@ def prove(assumptions, claim, declared_vars=None, var_types=None, steps=None):
                     
                     # For each case, assume the condition and verify steps
                     case_assumptions = current_assumptions + [condition]
+                    case_stats = {}
                     for cs in case_steps:
                         cs_formula = cs.get("formula")
                         if cs_formula:
                             # Check if this step is provable under the case assumption
                             s = Solver()
                             for a in case_assumptions:
-                                s.add(formula_to_z3(a, env.copy(), var_types))
-                            s.add(Not(formula_to_z3(cs_formula, env.copy(), var_types)))
-                            if s.check() == unsat:
+                                s.add(translate(a, env.copy()))
+                            if check_goal(s, cs_formula, env.copy(), var_types,
+                                          premises, premise_limit, timings) == unsat:
                                 case_assumptions.append(cs_formula)
+                            if stats:
+                                merge_stats(case_stats, solver_stats(s))
                     
                     case_results.append({"case": case_idx + 1, "ok": True})
+                    if stats:
+                        case_results[-1]["stats"] = case_stats
                 
                 # Check if cases are exhaustive: disjunction of conditions should be tautology
                 # (given current assumptions)
                 if conditions:
                     s = Solver()
                     for a in current_assumptions:
-                        s.add(formula_to_z3(a, env.copy(), var_types))
+                        s.add(translate(a, env.copy()))
                     
                     # Negate (cond1 OR cond2 OR ...) 
-                    cond_z3 = [formula_to_z3(c, env.copy(), var_types) for c in conditions]
-                    s.add(Not(Or(*cond_z3)))
-                    
-                    exhaustive = s.check() == unsat
+                    exhaustive = check_goal(s, {"type": "or", "args": conditions},
+                                            env.copy(), var_types,
+                                            premises, premise_limit, timings) == unsat
                     if not exhaustive:
                         all_cases_ok = False
-                        step_results.append({
+                        entry = {
                             "step": i + 1,
                             "type": "cases",
                             "ok": False,
                             "status": "non-exhaustive",
                             "message": "Cases may not cover all possibilities"
-                        })
+                        }
                     else:
-                        step_results.append({
+                        entry = {
                             "step": i + 1,
                             "type": "cases",
                             "ok": True,
                             "status": "proven",
                             "case_results": case_results
-                        })
+                        }
+                    if stats:
+                        # Statistics of the exhaustiveness check
+                        entry["stats"] = solver_stats(s)
+                    record(entry)
+                else:
+                    # No step result, but keep timings.steps aligned with steps
+                    timings.steps.append(timings.phases["solve"] - step_start)
                 continue
             
             step_formula = step.get("formula")
             if step_formula is None:
-                step_results.append({"step": i + 1, "ok": False, "error": "Step missing formula"})
+                record({"step": i + 1, "ok": False, "error": "Step missing formula"})
                 continue
             
             s = Solver()
             for a in current_assumptions:
-                s.add(formula_to_z3(a, env.copy(), var_types))
+                s.add(translate(a, env.copy()))
             
-            step_z3 = formula_to_z3(step_formula, env.copy(), var_types)
-            s.add(Not(step_z3))
-            
-            result = s.check()
+            result = check_goal(s, step_formula, env.copy(), var_types,
+                                premises, premise_limit, timings)
+            step_stats = {"stats": solver_stats(s)} if stats else {}
             
             if result == unsat:
-                step_results.append({"step": i + 1, "ok": True, "status": "proven"})
+                record({"step": i + 1, "ok": True, "status": "proven", **step_stats})
                 # Add the proven step as an assumption for subsequent steps
                 current_assumptions.append(step_formula)
             elif result == sat:
-                m = s.model()
-                model_out = {name: str(m.eval(v, model_completion=True)) for name, v in env.items()}
-                step_results.append({
-                    "step": i + 1, 
-                    "ok": False, 
-                    "status": "disproven",
-                    "model": model_out
-                })
+                model_out = counterexample(s, step_formula, env)
+                entry = {"step": i + 1, "ok": False, "status": "disproven"}
+                if model_out is not None:
+                    entry["model"] = model_out
+                record({**entry, **step_stats})
                 # Don't add unproven steps to assumptions
             else:
-                step_results.append({"step": i + 1, "ok": False, "status": "unknown"})
+                record({"step": i + 1, "ok": False, "status": "unknown", **step_stats})
 
         # Now prove the final claim
         s = Solver()
         
         # Add all original assumptions plus proven steps
         for a in current_assumptions:
-            s.add(formula_to_z3(a, env, var_types))
-
-        # Convert the claim
-        claim_z3 = formula_to_z3(claim, env, var_types)
+            s.add(translate(a, env))
 
         # Prove: assumptions => claim
         # Check UNSAT of: assumptions AND (NOT claim)
-        s.add(Not(claim_z3))
-
-        result = s.check()
+        claim_start = timings.phases["solve"]
+        result = check_goal(s, claim, env, var_types, premises, premise_limit, timings)
+        timings.claim = timings.phases["solve"] - claim_start
+        claim_stats = {"stats": solver_stats(s)} if stats else {}
         
         if result == unsat:
-            response = {"ok": True, "status": "proven"}
-            if step_results:
-                response["step_results"] = step_results
-            return response
+            return finish({"ok": True, "status": "proven", **claim_stats})
         
         if result == sat:
-            m = s.model()
-            model_out = {
-                name: str(m.eval(v, model_completion=True)) 
-                for name, v in env.items()
-            }
-            response = {
-                "ok": False, 
-                "status": "disproven",
-                "model": model_out,
-                "message": format_counterexample(m, env)
-            }
-            if step_results:
-                response["step_results"] = step_results
-            return response
+            response = {"ok": False, "status": "disproven"}
+            model_out = counterexample(s, claim, env)
+            if model_out is not None:
+                response["model"] = model_out
+                response["message"] = format_counterexample(model_out)
+            return finish({**response, **claim_stats})
         
         # result == unknown
-        response = {
+        return finish({
             "ok": False,
             "status": "unknown",
-            "message": "Z3 could not determine satisfiability (timeout or incomplete theory)"
-        }
-        if step_results:
-            response["step_results"] = step_results
-        return response
+            "message": "Z3 could not determine satisfiability (timeout or incomplete theory)",
+            **claim_stats
+        })
 
     except (TermError, FormulaError) as e:
         return {
@@ -448,8 +770,11 @@ def prove(assumptions, claim, declared_vars=None, var_types=None, steps=None):
 
 def main():
     """Main entry point - reads JSON from stdin, outputs JSON to stdout."""
+    # Read everything first so decode time excludes waiting on the pipe
+    data = sys.stdin.read()
+    start = time.perf_counter_ns()
     try:
-        req = json.load(sys.stdin)
+        req = json.loads(data)
     except json.JSONDecodeError as e:
         json.dump({"ok": False, "status": "error", "error": f"Invalid JSON: {e}"}, sys.stdout)
         return
@@ -458,13 +783,22 @@ def main():
     var_types = req.get("var_types", {})
     assumptions = req.get("assumptions", [])
     steps = req.get("steps", [])
+    premises = req.get("premises", [])
+    premise_limit = req.get("premise_limit", DEFAULT_PREMISE_LIMIT)
     claim = req.get("claim")
     
     if claim is None:
         json.dump({"ok": False, "status": "error", "error": "Missing 'claim' field"}, sys.stdout)
         return
 
-    result = prove(assumptions, claim, declared_vars, var_types, steps)
+    decode = (time.perf_counter_ns() - start) // 1000
+    result = prove(assumptions, claim, declared_vars, var_types, steps,
+                   premises, premise_limit, stats=req.get("stats", False),
+                   memory=req.get("memory", False),
+                   model=req.get("model", "full"),
+                   model_format=req.get("model_format", "exact"))
+    if "timings" in result:
+        result["timings"]["decode"] = decode
     json.dump(result, sys.stdout)
 
 
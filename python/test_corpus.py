@@ -0,0 +1,36 @@
+import json
+
+import pytest
+from corpus import FAMILIES, generate, write_corpus
+from parser import parse
+
+
+class TestCorpus:
+    @pytest.mark.parametrize("family", sorted(FAMILIES))
+    def test_families_parse(self, family):
+        for disproven in (False, True):
+            source, expected = generate(family, 3, disproven)
+            ast = parse(source)
+            assert "claim" in ast
+            assert expected == ("disproven" if disproven else "proven")
+
+    def test_sizes_scale(self):
+        small = parse(generate("chain", 2)[0])
+        large = parse(generate("chain", 20)[0])
+        assert len(small["assumptions"]) == 2
+        assert len(large["assumptions"]) == 20
+
+        cases = parse(generate("cases", 3)[0])
+        assert len(cases["steps"][0]["cases"]) == 8
+
+    def test_write_corpus(self, tmp_path):
+        manifest = write_corpus(str(tmp_path), ["sum", "apply"], [2, 5],
+                                disproven=True)
+        assert len(manifest) == 8
+        assert json.loads((tmp_path / "manifest.json").read_text()) == manifest
+        for entry in manifest:
+            assert (tmp_path / entry["proof"]).exists()
+            request = json.loads((tmp_path / entry["request"]).read_text())
+            assert "claim" in request
+        apply_5 = json.loads((tmp_path / "apply_5.json").read_text())
+        assert len(apply_5["premises"]) == 5
@@ -0,0 +1,24 @@
+from differential import disagreements, statuses
+
+
+def result(status, *steps):
+    out = {"ok": status == "proven", "status": status}
+    if steps:
+        out["step_results"] = [{"step": i + 1, "status": s}
+                               for i, s in enumerate(steps)]
+    return out
+
+
+class TestDifferential:
+    def test_statuses(self):
+        assert statuses(result("proven", "proven", "unknown")) == {
+            "claim": "proven", "step 1": "proven", "step 2": "unknown"}
+
+    def test_agree(self):
+        assert disagreements(result("proven", "proven"),
+                             result("proven", "proven")) == []
+
+    def test_disagree(self):
+        diff = disagreements(result("proven", "proven", "disproven"),
+                             result("unknown", "proven"))
+        assert diff == ["claim: proven vs unknown", "step 2: disproven vs -"]
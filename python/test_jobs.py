@@ -0,0 +1,153 @@
+import threading
+import time
+import pytest
+from jobs import JobQueue, QueueFull, CancelToken, DONE
+
+
+def echo_checker():
+    return lambda request, on_step, cancel, session: {"ok": True, "status": "proven", "request": request}
+
+
+class TestJobQueue:
+    def test_submit_and_wait(self):
+        queue = JobQueue(echo_checker, workers=2)
+        job_id = queue.submit({"claim": 1})
+        job = queue.wait(job_id, timeout=5)
+        assert job["state"] == DONE
+        assert job["result"]["request"] == {"claim": 1}
+        assert queue.get(job_id) == job
+        queue.stop()
+
+    def test_unknown_job(self):
+        queue = JobQueue(echo_checker, workers=1)
+        assert queue.get("missing") is None
+        assert queue.wait("missing", timeout=0) is None
+        queue.stop()
+
+    def test_wait_timeout_and_queue_limit(self):
+        release = threading.Event()
+
+        def blocking_checker():
+            def check(request, on_step, cancel, session):
+                release.wait()
+                return {"ok": True}
+            return check
+
+        queue = JobQueue(blocking_checker, workers=1, max_pending=1)
+        first = queue.submit(1)
+        # Let the single worker pick up the first job
+        while queue.pending():
+            time.sleep(0.001)
+        second = queue.submit(2)
+        with pytest.raises(QueueFull):
+            queue.submit(3)
+        assert queue.wait(second, timeout=0.05)["state"] == "queued"
+
+        release.set()
+        assert queue.wait(first, timeout=5)["state"] == DONE
+        assert queue.wait(second, timeout=5)["state"] == DONE
+        queue.stop()
+
+    def test_checker_errors_are_results(self):
+        def failing_checker():
+            def check(request, on_step, cancel, session):
+                raise RuntimeError("boom")
+            return check
+
+        queue = JobQueue(failing_checker, workers=1)
+        job = queue.wait(queue.submit({}), timeout=5)
+        assert job["result"]["status"] == "error"
+        assert "boom" in job["result"]["error"]
+        queue.stop()
+
+    def test_finished_jobs_expire(self):
+        queue = JobQueue(echo_checker, workers=1, retention=0)
+        job_id = queue.submit({})
+        queue.wait(job_id, timeout=5)
+        queue.submit({})  # submitting prunes expired jobs
+        assert queue.get(job_id) is None
+        queue.stop()
+
+    def test_streamed_events(self):
+        release = threading.Event()
+
+        def stepping_checker():
+            def check(request, on_step, cancel, session):
+                on_step({"step": 1, "ok": True})
+                release.wait()
+                on_step({"step": 2, "ok": False})
+                return {"ok": False}
+            return check
+
+        queue = JobQueue(stepping_checker, workers=1)
+        job_id = queue.submit({})
+        events, job = queue.events(job_id, 0, timeout=5)
+        assert events == [{"step": 1, "ok": True}]
+        assert job["state"] == "running"
+
+        release.set()
+        seen = 1
+        while job["state"] != DONE:
+            events, job = queue.events(job_id, seen, timeout=5)
+            seen += len(events)
+        assert seen == 2
+        assert job["result"] == {"ok": False}
+        assert queue.events("missing") is None
+        queue.stop()
+
+    def test_session_supersedes(self):
+        started = threading.Event()
+
+        def cancellable_checker():
+            def check(request, on_step, cancel, session):
+                if request == "slow":
+                    stop = threading.Event()
+                    cancel.add_callback(stop.set)
+                    started.set()
+                    stop.wait(5)
+                return {"ok": True, "status": "proven"}
+            return check
+
+        queue = JobQueue(cancellable_checker, workers=1)
+        running = queue.submit("slow", session="editor")
+        started.wait(5)
+        queued = queue.submit("slow", session="editor")
+        other = queue.submit("fast", session="other")
+        latest = queue.submit("fast", session="editor")
+
+        # Every superseded revision ends cancelled, whether it was still
+        # queued or already running
+        assert queue.wait(running, timeout=5)["result"]["status"] == "cancelled"
+        assert queue.wait(queued, timeout=5)["result"]["status"] == "cancelled"
+        assert queue.wait(other, timeout=5)["result"]["status"] == "proven"
+        assert queue.wait(latest, timeout=5)["result"]["status"] == "proven"
+        queue.stop()
+
+    def test_sessions_pinned_to_one_worker(self):
+        workers = {}  # session -> checkers that saw it
+
+        def recording_checker():
+            def check(request, on_step, cancel, session):
+                workers.setdefault(session, set()).add(id(check))
+                time.sleep(0.01)
+                return {"ok": True, "session": session}
+            return check
+
+        queue = JobQueue(recording_checker, workers=3)
+        # Waiting for each job keeps any revision from being superseded
+        for i in range(6):
+            for session in ("a", "b"):
+                job = queue.wait(queue.submit(i, session=session), timeout=5)
+                assert job["result"]["session"] == session
+        assert len(workers["a"]) == 1 and len(workers["b"]) == 1
+        queue.stop()
+
+    def test_cancel_token(self):
+        token = CancelToken()
+        calls = []
+        token.add_callback(lambda: calls.append(1))
+        token.cancel()
+        token.cancel()
+        token.add_callback(lambda: calls.append(2))
+        assert token.cancelled
+        assert calls == [1, 2]
@@ -0,0 +1,95 @@
+import pytest
+from library import (compile_library, load_library, read_artifact,
+                     artifact_path, content_hash, LibraryError)
+from parser import parse
+
+
+LIB = """
+theorem positive_sum:
+    assume a > 0
+    assume b > 0
+    prove a + b > 0
+"""
+
+
+class TestLibrary:
+    def test_content_hash(self):
+        # FNV-1a 64 reference values
+        assert content_hash(b"") == 0xcbf29ce484222325
+        assert content_hash(b"a") == 0xaf63dc4c8601ec8c
+
+    def test_compile_and_load(self, tmp_path):
+        src = tmp_path / "lib.proof"
+        src.write_text(LIB)
+        path = compile_library(str(src), verify=False)
+        assert path == artifact_path(str(src))
+
+        lib = load_library(str(src))
+        assert lib is not None
+        assert lib["sources"] == [str(src)]
+        theorem = lib["theorems"]["positive_sum"]
+        assert theorem["status"] == "unverified"
+        assert len(theorem["assumptions"]) == 2
+
+    def test_transitive_imports_recorded(self, tmp_path):
+        (tmp_path / "base.proof").write_text(LIB)
+        src = tmp_path / "top.proof"
+        src.write_text('import "base.proof"\n')
+        compile_library(str(src), verify=False)
+        sources = [s for s, _ in read_artifact(artifact_path(str(src)))["sources"]]
+        assert str(tmp_path / "base.proof") in sources
+
+    def test_stale_artifact_ignored(self, tmp_path):
+        (tmp_path / "base.proof").write_text(LIB)
+        src = tmp_path / "top.proof"
+        src.write_text('import "base.proof"\n')
+        compile_library(str(src), verify=False)
+
+        # Changing a transitive import invalidates the artifact
+        (tmp_path / "base.proof").write_text(LIB.replace("positive_sum", "renamed"))
+        assert load_library(str(src)) is None
+
+        ast = parse('import "top.proof"\napply renamed\nprove x > 0', str(tmp_path))
+        assert ast["premises"][0]["name"] == "renamed"
+
+    def test_import_uses_artifact(self, tmp_path):
+        src = tmp_path / "lib.proof"
+        src.write_text(LIB)
+        compile_library(str(src), verify=False)
+        ast = parse('import "lib.proof"\napply positive_sum\nprove x > 0', str(tmp_path))
+        assert ast["theorems"]["positive_sum"]["status"] == "unverified"
+
+    def test_corrupt_artifact(self, tmp_path):
+        path = tmp_path / "bad.plib"
+        path.write_bytes(b"NOTALIB" + bytes(40))
+        with pytest.raises(LibraryError):
+            read_artifact(str(path))
+
+    def test_theorem_var_types_recorded(self, tmp_path):
+        src = tmp_path / "lib.proof"
+        src.write_text("let n: Int\nlet y: Real\n"
+                       "theorem sq_ge:\n    prove n * n >= n\n")
+        compile_library(str(src), verify=False)
+        theorem = load_library(str(src))["theorems"]["sq_ge"]
+        # Only the theorem's own variables
+        assert theorem["var_types"] == {"n": "Int"}
+
+    def test_import_keeps_theorem_var_types(self, tmp_path):
+        src = tmp_path / "lib.proof"
+        src.write_text("let n: Int\ntheorem sq_ge:\n    prove n * n >= n\n")
+        # n is undeclared here, so it stays Real whatever the library says
+        proof = 'import "lib.proof"\nlet m: Real\nprove n >= 0 or m < 0'
+        from_source = parse(proof, str(tmp_path))
+        compile_library(str(src), verify=False)
+        from_artifact = parse(proof, str(tmp_path))
+        for ast in (from_source, from_artifact):
+            assert ast["var_types"] == {"m": "Real"}
+            assert ast["theorems"]["sq_ge"]["var_types"] == {"n": "Int"}
+
+    def test_import_keeps_own_declarations(self, tmp_path):
+        src = tmp_path / "lib.proof"
+        src.write_text("let n: Int\ntheorem sq_ge:\n    prove n * n >= n\n")
+        compile_library(str(src), verify=False)
+        ast = parse('import "lib.proof"\nlet n: Real\nprove n >= 0 or n < 0',
+                    str(tmp_path))
+        assert ast["var_types"]["n"] == "Real"
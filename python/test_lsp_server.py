@@ -0,0 +1,70 @@
+import io
+import pytest
+from lsp_server import (result_diagnostics, parse_diagnostics, read_message,
+                        write_message, ERROR, WARNING, HINT)
+from parser import parse, ParseError
+
+
+PROOF = """assume x > 0
+have x >= 0
+have x > 5
+cases:
+    case x > 1:
+        have x > 1
+    case x <= 1:
+        have x > 0
+prove x > -1
+"""
+
+
+class TestLspServer:
+    def test_message_framing(self):
+        stream = io.BytesIO()
+        write_message(stream, {"id": 1, "method": "initialize"})
+        stream.seek(0)
+        assert read_message(stream) == {"id": 1, "method": "initialize"}
+        assert read_message(stream) is None
+
+    def test_step_diagnostics(self):
+        ast = parse(PROOF)
+        result = {
+            "ok": True, "status": "proven", "depends_on": ["assumption 1"],
+            "step_results": [
+                {"step": 1, "ok": True, "status": "proven"},
+                {"step": 2, "ok": False, "status": "disproven", "model": {"x": "1"}},
+                {"step": 3, "type": "cases", "ok": True, "status": "proven",
+                 "case_results": [
+                     {"case": 1, "ok": True,
+                      "step_results": [{"step": 1, "ok": True, "status": "proven"}]},
+                     {"case": 2, "ok": False,
+                      "step_results": [{"step": 1, "ok": False, "status": "unknown"}]},
+                 ]},
+            ],
+        }
+        diags = result_diagnostics(ast, result, PROOF.split("\n"))
+        by_line = {d["range"]["start"]["line"]: d for d in diags}
+        assert by_line[1]["severity"] == HINT
+        assert by_line[2]["severity"] == ERROR
+        assert "x = 1" in by_line[2]["message"]
+        assert by_line[5]["severity"] == HINT
+        assert by_line[5]["range"]["start"]["character"] == 8
+        assert by_line[7]["severity"] == WARNING
+        assert by_line[8]["message"] == "Claim proven from assumption 1"
+
+    def test_non_exhaustive_cases(self):
+        ast = parse(PROOF)
+        result = {"ok": True, "status": "proven", "step_results": [
+            {"step": 3, "type": "cases", "ok": False, "status": "non-exhaustive",
+             "message": "Cases may not cover all possibilities"},
+        ]}
+        diags = result_diagnostics(ast, result, PROOF.split("\n"))
+        assert diags[0]["range"]["start"]["line"] == 3
+        assert diags[0]["severity"] == WARNING
+
+    def test_parse_error_diagnostics(self):
+        text = "assume x >\nprove x >> 1\n"
+        with pytest.raises(ParseError) as info:
+            parse(text)
+        diags = parse_diagnostics(info.value, text.split("\n"))
+        assert [d["range"]["start"]["line"] for d in diags] == [0, 1]
+        assert all(d["severity"] == ERROR for d in diags)
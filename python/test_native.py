@@ -0,0 +1,430 @@
+"""Tests of the C++ engine, run against the built binary (cpp/build/prover
+or $PROOFCHECKER_PROVER); skipped when it has not been built."""
+
+import json
+import os
+import signal
+import socket
+import subprocess
+import time
+
+import pytest
+
+from library import compile_library, read_artifact, write_artifact
+from native import default_binary
+
+
+BINARY = default_binary()
+
+pytestmark = pytest.mark.skipif(not os.path.exists(BINARY),
+                                reason="C++ prover not built")
+
+
+def var(name):
+    return {"type": "var", "name": name}
+
+
+def num(val):
+    return {"type": "num", "value": val}
+
+
+def binary(op, lhs, rhs):
+    return {"type": "bin", "op": op, "lhs": lhs, "rhs": rhs}
+
+
+def rel(op, lhs, rhs):
+    return {"type": "rel", "op": op, "lhs": lhs, "rhs": rhs}
+
+
+def power(base, exp):
+    return {"type": "pow", "base": base, "exp": num(exp)}
+
+
+def run(request, *args, cache_dir=None):
+    """Check one request with a fresh engine process, with the theorem
+    cache in cache_dir if given, otherwise without one."""
+    cache = ["--cache-dir", str(cache_dir)] if cache_dir else ["--no-cache"]
+    proc = subprocess.run([BINARY, *cache, *args], input=json.dumps(request),
+                          capture_output=True, text=True, timeout=120)
+    return json.loads(proc.stdout)
+
+
+def serve(requests, *args, before_exit=None):
+    """Send requests one at a time to a single `prover --serve` process,
+    each once the previous one is answered; returns the responses.
+    before_exit, if given, is called once all are answered, while the
+    process is still running."""
+    proc = subprocess.Popen([BINARY, "--serve", "--no-cache", *args],
+                            stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                            text=True)
+    responses = []
+    try:
+        for request in requests:
+            proc.stdin.write(json.dumps(request) + "\n")
+            proc.stdin.flush()
+            while True:
+                response = json.loads(proc.stdout.readline())
+                if "event" not in response:
+                    break
+            responses.append(response)
+        if before_exit:
+            before_exit()
+    finally:
+        proc.stdin.close()
+        proc.wait(timeout=60)
+    return responses
+
+
+def scrape(socket_path):
+    """Fetch the Prometheus metrics of a daemon started with
+    --metrics-socket socket_path."""
+    with socket.socket(socket.AF_UNIX) as sock:
+        sock.settimeout(30)
+        sock.connect(socket_path)
+        sock.sendall(b"GET /metrics HTTP/1.0\r\nHost: localhost\r\n\r\n")
+        chunks = []
+        while chunk := sock.recv(65536):
+            chunks.append(chunk)
+    return b"".join(chunks).decode()
+
+
+class TestLibraries:
+    def proven_int_library(self, tmp_path):
+        """An artifact recording n * n >= n, over the integers, as proven."""
+        src = tmp_path / "lib.proof"
+        src.write_text("let n: Int\ntheorem sq_ge:\n    prove n * n >= n\n")
+        path = compile_library(str(src), verify=False)
+        artifact = read_artifact(path)
+        artifact["theorems"]["sq_ge"]["status"] = "proven"
+        write_artifact(path, artifact["sources"], artifact["theorems"])
+        return path
+
+    def test_status_not_trusted_under_other_types(self, tmp_path):
+        path = self.proven_int_library(tmp_path)
+        # Over the reals n * n >= n fails for n = 1/2
+        result = run({"vars": ["n"],
+                      "assumptions": [rel("=", var("n"), num("1/2"))],
+                      "claim": rel("<", num(1), num(0)),
+                      "libraries": [path],
+                      "premises": [{"name": "sq_ge"}]})
+        assert result["status"] == "error"
+        assert result["theorem_results"]["sq_ge"] == {"status": "disproven",
+                                                      "cached": False}
+
+    def test_status_trusted_under_recorded_types(self, tmp_path):
+        path = self.proven_int_library(tmp_path)
+        result = run({"vars": ["n"], "var_types": {"n": "Int"},
+                      "assumptions": [rel(">=", var("n"), num(2))],
+                      "claim": rel(">=", binary("*", var("n"), var("n")), var("n")),
+                      "libraries": [path],
+                      "premises": [{"name": "sq_ge"}]})
+        assert result["status"] == "proven"
+        assert result["theorem_results"]["sq_ge"] == {"status": "proven",
+                                                      "cached": True}
+
+    def test_preload_keys_status_by_recorded_types(self, tmp_path):
+        path = self.proven_int_library(tmp_path)
+        request = {"vars": ["n"],
+                   "assumptions": [rel("=", var("n"), num("1/2"))],
+                   "claim": rel("<", num(1), num(0)),
+                   "libraries": [path],
+                   "premises": [{"name": "sq_ge"}]}
+        [result] = serve([request], "--preload", path)
+        assert result["theorem_results"]["sq_ge"]["status"] == "disproven"
+
+
+class TestTheoremCache:
+    # x > x is false; a cache entry saying otherwise must not be believed
+    REQUEST = {"theorems": {"t": {"assumptions": [],
+                                  "conclusion": rel(">", var("x"), var("x"))}},
+               "claim": rel(">=", num(1), num(0))}
+
+    def forge(self, tmp_path, header):
+        """Rewrite the cache so that it records theorem t as proven."""
+        path = tmp_path / "theorems"
+        lines = path.read_text().splitlines()
+        entries = [line.replace("disproven", "proven") for line in lines[1:]]
+        path.write_text("\n".join([header, *entries]) + "\n")
+        return lines[0]
+
+    def test_cache_from_other_version_discarded(self, tmp_path):
+        first = run(self.REQUEST, cache_dir=tmp_path)
+        assert first["theorem_results"]["t"] == {"status": "disproven",
+                                                 "cached": False}
+        header = self.forge(tmp_path, "proofchecker-theorems 0")
+        second = run(self.REQUEST, cache_dir=tmp_path)
+        assert second["theorem_results"]["t"] == {"status": "disproven",
+                                                  "cached": False}
+        # The same entries under the current version are used
+        self.forge(tmp_path, header)
+        third = run(self.REQUEST, cache_dir=tmp_path)
+        assert third["theorem_results"]["t"] == {"status": "proven",
+                                                 "cached": True}
+
+
+# x*y + y*z + z*x = 3 with positive x, y, z implies x*y*z <= 1: nonlinear,
+# and takes Z3 some tens of milliseconds
+HARD = {
+    "assumptions": [
+        rel("=", binary("+", binary("+", binary("*", var("x"), var("y")),
+                                    binary("*", var("y"), var("z"))),
+                        binary("*", var("z"), var("x"))), num(3)),
+        rel(">", var("x"), num(0)),
+        rel(">", var("y"), num(0)),
+        rel(">", var("z"), num(0)),
+    ],
+    "claim": rel("<=", binary("*", binary("*", var("x"), var("y")), var("z")),
+                 num(1)),
+}
+
+
+# x^2 y^4 + x^4 y^2 + z^6 >= 3 x^2 y^2 z^2 (AM-GM): Z3 needs a couple of
+# seconds for it as a whole, much less with the signs of x and y fixed
+AM_GM = {
+    "claim": rel(">=",
+                 binary("+", binary("+",
+                                    binary("*", power(var("x"), 2), power(var("y"), 4)),
+                                    binary("*", power(var("x"), 4), power(var("y"), 2))),
+                        power(var("z"), 6)),
+                 binary("*", binary("*", binary("*", num(3), power(var("x"), 2)),
+                                    power(var("y"), 2)),
+                        power(var("z"), 2))),
+}
+
+
+class TestSessions:
+    def test_unchanged_obligations_reused(self):
+        request = {"session": "doc",
+                   "assumptions": [rel(">", var("x"), num(0)),
+                                   rel(">", var("y"), num(0))],
+                   "steps": [{"formula": rel(">", binary("+", var("x"), var("y")),
+                                             num(0))}],
+                   "claim": rel(">", binary("+", var("x"), num(1)), num(1))}
+        # An unrelated assumption leaves the claim's dependencies in scope
+        edited = dict(request, assumptions=request["assumptions"] +
+                      [rel(">", var("w"), num(5))])
+        first, second, third = serve([request, request, edited])
+        assert first["status"] == "proven" and not first["cached"]
+        assert second["cached"] and second["step_results"][0]["cached"]
+        assert second["depends_on"] == ["assumption 1"]
+        assert third["cached"]
+
+    def test_changed_dependency_rechecked(self):
+        request = {"session": "doc",
+                   "assumptions": [rel(">", var("x"), num(0))],
+                   "claim": rel(">", binary("+", var("x"), num(1)), num(1))}
+        edited = dict(request, assumptions=[rel(">", var("x"), num(-1))])
+        first, second = serve([request, edited])
+        assert first["status"] == "proven"
+        assert second["status"] == "disproven" and not second["cached"]
+
+    def test_timeout_validated(self):
+        request = {"claim": rel(">=", var("y"), var("y"))}
+        for bad in (-1, 1.5, "100", 2**32):
+            result = run(dict(request, timeout_ms=bad))
+            assert result["status"] == "error"
+            assert "timeout_ms" in result["error"]
+        assert run(dict(request, timeout_ms=0))["status"] == "proven"
+
+    def test_timeout_not_reused(self):
+        request = dict(HARD, session="doc", sign_split=False)
+        first, second = serve([dict(request, timeout_ms=1),
+                               dict(request, timeout_ms=60000)])
+        assert second["status"] == "proven"
+        # A proof may be reused; running out of time may not
+        assert second["cached"] == (first["status"] == "proven")
+
+
+class TestContextReuse:
+    # Requests without quantifiers run on pooled Z3 contexts; consecutive
+    # requests to one process reuse the same context
+
+    def test_declarations_do_not_leak(self, tmp_path):
+        as_int = {"vars": ["n"], "var_types": {"n": "Int"},
+                  "assumptions": [rel(">", var("n"), num(0))],
+                  "claim": rel(">=", var("n"), num(1))}
+        as_real = {"vars": ["n"],
+                   "assumptions": [rel(">", var("n"), num(0))],
+                   "claim": rel(">=", var("n"), num(1))}
+        sock = str(tmp_path / "metrics.sock")
+        metrics = []
+        first, second, third = serve(
+            [as_int, as_real, as_int], "--metrics-socket", sock,
+            before_exit=lambda: metrics.append(scrape(sock)))
+        assert 'prover_cache_hits_total{cache="context"} 2' in metrics[0]
+        assert first["status"] == "proven"
+        assert second["status"] == "disproven"
+        assert third["status"] == "proven"
+
+    def test_assertions_do_not_leak(self):
+        assumed = {"vars": ["x"], "assumptions": [rel(">", var("x"), num(5))],
+                   "claim": rel(">", var("x"), num(5))}
+        bare = {"vars": ["x"], "claim": rel(">", var("x"), num(5))}
+        first, second = serve([assumed, bare])
+        assert first["status"] == "proven"
+        assert second["status"] == "disproven"
+
+
+class TestSignSplit:
+    def test_split_proves_unknown_goal(self):
+        request = dict(AM_GM, timeout_ms=500, stats=True)
+        whole = run(dict(request, sign_split=False))
+        assert whole["status"] == "unknown"
+        assert "sign_split_cases" not in whole["stats"]
+        # The split gets what the first check leaves of the same limit
+        split = run(request)
+        assert split["status"] == "proven"
+        assert split["stats"]["sign_split_cases"] == 9
+
+
+def pigeons(count, holes):
+    """Each of count Int pigeons p0, p1, ... in its own hole 1..holes:
+    satisfiable exactly when count <= holes. Claims false."""
+    names = [f"p{i}" for i in range(count)]
+    assumptions = [{"type": "and", "args": [rel(">=", var(p), num(1)),
+                                            rel("<=", var(p), num(holes))]}
+                   for p in names]
+    assumptions += [rel("!=", var(a), var(b))
+                    for i, a in enumerate(names) for b in names[i + 1:]]
+    return {"vars": names, "var_types": {p: "Int" for p in names},
+            "assumptions": assumptions, "claim": rel("<", num(1), num(0))}
+
+
+class TestCubes:
+    def test_depth_validated(self):
+        for bad in (-1, 9, 1.5, "2"):
+            result = run(dict(pigeons(3, 2), cube_depth=bad))
+            assert result["status"] == "error"
+            assert "cube_depth" in result["error"]
+
+    def test_unsat_proven_by_cubes(self):
+        result = run(dict(pigeons(5, 4), cube_depth=3, stats=True))
+        assert result["status"] == "proven"
+        assert 1 < result["stats"]["cubes"] <= 8
+
+    def test_sat_disproven_by_cube(self):
+        result = run(dict(pigeons(4, 4), cube_depth=2, stats=True))
+        assert result["status"] == "disproven"
+        assert 1 < result["stats"]["cubes"] <= 4
+        holes = {int(result["model"][f"p{i}"]) for i in range(4)}
+        assert holes == {1, 2, 3, 4}
+
+
+def child_pids(pid):
+    """Live child processes of pid."""
+    children = []
+    for entry in os.listdir("/proc"):
+        if not entry.isdigit():
+            continue
+        try:
+            with open(f"/proc/{entry}/stat") as f:
+                # The command name is in parentheses and may contain spaces
+                fields = f.read().rsplit(")", 1)[1].split()
+        except OSError:
+            continue
+        if int(fields[1]) == pid and fields[0] != "Z":
+            children.append(int(entry))
+    return children
+
+
+class TestPrefork:
+    def test_crashed_worker_replaced(self):
+        proc = subprocess.Popen([BINARY, "--serve", "--no-cache", "--prefork", "1"],
+                                stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                text=True)
+
+        def ask(request):
+            proc.stdin.write(json.dumps(request) + "\n")
+            proc.stdin.flush()
+
+        try:
+            deadline = time.monotonic() + 10
+            while not child_pids(proc.pid) and time.monotonic() < deadline:
+                time.sleep(0.01)
+            [worker] = child_pids(proc.pid)
+            ask(dict(AM_GM, id=1, sign_split=False))
+            # Let the worker get going on it
+            time.sleep(0.5)
+            os.kill(worker, signal.SIGKILL)
+            crashed = json.loads(proc.stdout.readline())
+            assert crashed["id"] == 1 and crashed["status"] == "error"
+            assert crashed["error"] == f"Worker crashed (signal {int(signal.SIGKILL)})"
+
+            ask({"id": 2, "claim": rel(">=", var("y"), var("y"))})
+            answered = json.loads(proc.stdout.readline())
+            assert answered["id"] == 2 and answered["status"] == "proven"
+            [replacement] = child_pids(proc.pid)
+            assert replacement != worker
+        finally:
+            proc.stdin.close()
+            proc.wait(timeout=60)
+
+    def test_sessions_past_limit(self):
+        # 256 per worker; the supervisor forgets the ones its worker drops
+        requests = [{"session": f"s{i}", "claim": rel(">=", var("y"), var("y"))}
+                    for i in range(300)]
+        responses = serve(requests + requests[:1] + requests[-1:], "--prefork", "2")
+        assert [r["status"] for r in responses] == ["proven"] * 302
+
+
+class TestMetrics:
+    def test_silent_client_does_not_block(self, tmp_path):
+        sock = str(tmp_path / "metrics.sock")
+        scraped = []
+
+        def scrape_past_silent_client():
+            with socket.socket(socket.AF_UNIX) as silent:
+                silent.connect(sock)
+                start = time.monotonic()
+                scraped.append(scrape(sock))
+                scraped.append(time.monotonic() - start)
+
+        [result] = serve([{"claim": rel(">=", var("y"), var("y"))}],
+                         "--metrics-socket", sock,
+                         before_exit=scrape_past_silent_client)
+        assert result["status"] == "proven"
+        body, waited = scraped
+        assert "prover_requests_total" in body
+        assert waited < 10
+
+
+class TestMemory:
+    def test_usage_is_per_request(self):
+        # The session keeps its solver, and everything it allocated, alive
+        chain = {"session": "big", "memory": True,
+                 "assumptions": [rel(">", var(f"x{i}"), var(f"x{i + 1}"))
+                                 for i in range(2000)],
+                 "claim": rel(">", var("x0"), var("x2000"))}
+        small = {"memory": True, "claim": rel(">=", var("y"), var("y"))}
+        big, after = serve([chain, small])
+        assert big["status"] == after["status"] == "proven"
+        assert after["memory"]["z3_solve"] < big["memory"]["z3_solve"] / 10
+        assert after["memory"]["process_peak_rss"] >= big["memory"]["process_peak_rss"]
+
+    def test_limit_validated(self):
+        request = {"claim": rel(">=", var("y"), var("y"))}
+        for bad in (-1, 1.5, "8"):
+            result = run(dict(request, max_memory_mb=bad))
+            assert result["status"] == "error"
+            assert "max_memory_mb" in result["error"]
+        # Too large to shift into bytes: as good as no limit
+        assert run(dict(request, max_memory_mb=2**64 - 1))["status"] == "proven"
+
+    def test_limit_exhausted(self):
+        chain = {"session": "chain",
+                 "assumptions": [rel(">", var(f"x{i}"), var(f"x{i + 1}"))
+                                 for i in range(2000)],
+                 "claim": rel(">", var("x0"), var("x2000"))}
+        # The request itself fits; what Z3 needs for it does not
+        first, second = serve([dict(chain, max_memory_mb=20), chain])
+        assert first["status"] == "resource_exhausted"
+        assert second["status"] == "proven"
+
+    def test_limit_covers_theorems(self):
+        chain = {"assumptions": [rel(">", var(f"x{i}"), var(f"x{i + 1}"))
+                                 for i in range(2000)],
+                 "conclusion": rel(">", var("x0"), var("x2000"))}
+        request = {"theorems": {"chain": chain}, "claim": rel(">=", num(1), num(0))}
+        # Verifying the theorem is what needs the memory
+        assert run(request)["status"] == "proven"
+        assert run(dict(request, max_memory_mb=20))["status"] == "resource_exhausted"
@@ -55,3 +55,67 @@ class TestParser:
     def test_unknown_token(self):
         with pytest.raises(ParseError):
             parse("prove x @ 0")
+
+    def test_apply_adds_premise(self):
+        text = """
+        theorem positive_sum:
+            assume a > 0
+            assume b > 0
+            prove a + b > 0
+        assume x > 0
+        apply positive_sum
+        prove x > 0
+        """
+        ast = parse(text)
+        assert len(ast["assumptions"]) == 1
+        assert len(ast["premises"]) == 1
+        premise = ast["premises"][0]
+        assert premise["name"] == "positive_sum"
+        assert premise["formula"]["type"] == "implies"
+        assert premise["formula"]["lhs"]["type"] == "and"
+
+    def test_apply_instantiation(self):
+        text = """
+        theorem positive_sum:
+            assume a > 0
+            assume b > 0
+            prove a + b > 0
+        apply positive_sum(x, y * 2)
+        prove x > 0
+        """
+        ast = parse(text)
+        formula = ast["premises"][0]["formula"]
+        assert formula["type"] == "instantiate"
+        assert formula["theorem"] == "positive_sum"
+        assert formula["vars"] == ["a", "b"]
+        assert formula["args"][0] == {"type": "var", "name": "x"}
+        assert formula["args"][1]["op"] == "*"
+
+    def test_apply_instantiation_arity(self):
+        text = """
+        theorem positive_sum:
+            assume a > 0
+            assume b > 0
+            prove a + b > 0
+        apply positive_sum(x)
+        prove x > 0
+        """
+        with pytest.raises(ParseError):
+            parse(text)
+
+    def test_source_lines(self):
+        text = "assume x > 0\nhave x >= 0\ncases:\n    case x > 1:\n        have x > 1\nprove x > -1\n"
+        ast = parse(text)
+        assert ast["steps"][0]["line"] == 2
+        cases = ast["steps"][1]
+        assert cases["line"] == 3
+        assert cases["cases"][0]["line"] == 4
+        assert cases["cases"][0]["steps"][0]["line"] == 5
+        assert ast["claim_line"] == 6
+
+    def test_collected_error_locations(self):
+        with pytest.raises(ParseError) as info:
+            parse("assume x >\nprove x >> 1\n")
+        errors = info.value.errors
+        assert [e.line for e in errors] == [1, 2]
+        assert errors[0].detail.startswith("Unexpected token")
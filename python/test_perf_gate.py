@@ -0,0 +1,37 @@
+from perf_gate import compare, percentile
+
+
+TOLERANCES = {"median_ms": 0.5, "p95_ms": 1.0}
+
+
+def entry(median, p95, status="proven"):
+    return {"status": status, "median_ms": median, "p95_ms": p95}
+
+
+class TestPerfGate:
+    def test_percentile(self):
+        samples = list(range(1, 21))
+        assert percentile(samples, 50) == 10
+        assert percentile(samples, 95) == 19
+        assert percentile([7.0], 95) == 7.0
+
+    def test_within_tolerance(self):
+        baseline = {"a": entry(10, 20)}
+        lines, regressed = compare(baseline, {"a": entry(17, 42)},
+                                   TOLERANCES, 2)
+        assert not regressed
+        assert lines[1].endswith("ok")
+
+    def test_regressions(self):
+        baseline = {"slow": entry(10, 20), "p95": entry(10, 20),
+                    "status": entry(10, 20), "gone": entry(10, 20)}
+        current = {"slow": entry(18, 20), "p95": entry(10, 43),
+                   "status": entry(10, 20, "unknown"), "new": entry(1, 1)}
+        lines, regressed = compare(baseline, current, TOLERANCES, 2)
+        assert regressed == {"slow", "p95", "status", "gone"}
+        report = "\n".join(lines)
+        assert "median over 17.0" in report
+        assert "p95 over 42.0" in report
+        assert "status proven -> unknown" in report
+        assert "missing from corpus" in report
+        assert "new (not in baseline)" in report
@@ -1,5 +1,5 @@
 import pytest
-from prover import prove
+from prover import prove, rank_premises, substitute
 
 # Helper to create basic term/formula structures
 def var(name):
@@ -70,3 +70,126 @@ class TestProver:
         result = prove([], {})
         assert result["ok"] is False
         assert result["status"] == "error"
+
+    def test_premise_ranking(self):
+        near = {"name": "near", "formula": rel(">", var("x"), var("y"))}
+        far = {"name": "far", "formula": rel(">", var("a"), num(0))}
+        ranked = rank_premises([far, near], {"x", "y"})
+        assert [p["name"] for p in ranked] == ["near", "far"]
+
+    def test_premise_selection_widens(self):
+        # x > 0, (x > 0 => w > 5) |- w > 5 with the needed premise tied
+        # with two useless ones and ranked last; widening must find it
+        premises = [
+            {"name": "p1", "formula": rel(">", var("w"), var("q"))},
+            {"name": "p2", "formula": rel(">", var("w"), var("r"))},
+            {"name": "needed", "formula": {
+                "type": "implies",
+                "lhs": rel(">", var("x"), num(0)),
+                "rhs": rel(">", var("w"), num(5)),
+            }},
+        ]
+        assumptions = [rel(">", var("x"), num(0))]
+        claim = rel(">", var("w"), num(5))
+
+        result = prove(assumptions, claim, ["x"], premises=premises, premise_limit=1)
+        assert result["ok"] is True
+
+        result = prove(assumptions, claim, ["x"], premises=premises[:2], premise_limit=1)
+        assert result["status"] == "disproven"
+
+    def test_substitute_avoids_capture(self):
+        # (forall y. a < y + b)[a := y, b := a] must rename the bound y
+        body = {"type": "forall", "vars": ["y"],
+                "body": rel("<", var("a"), binary("+", var("y"), var("b")))}
+        result = substitute(body, {"a": var("y"), "b": var("a")})
+        bound = result["vars"][0]
+        assert bound != "y"
+        assert result["body"]["lhs"] == var("y")
+        assert result["body"]["rhs"]["lhs"] == var(bound)
+        assert result["body"]["rhs"]["rhs"] == var("a")
+
+    def test_instantiated_premise(self):
+        # positive_sum(x, y + 1): x > 0 and y + 1 > 0 => x + (y + 1) > 0
+        theorem = {"type": "implies",
+                   "lhs": {"type": "and", "args": [rel(">", var("a"), num(0)),
+                                                   rel(">", var("b"), num(0))]},
+                   "rhs": rel(">", binary("+", var("a"), var("b")), num(0))}
+        premise = {"name": "positive_sum", "formula": {
+            "type": "instantiate",
+            "theorem": "positive_sum",
+            "vars": ["a", "b"],
+            "args": [var("x"), binary("+", var("y"), num(1))],
+            "body": theorem,
+        }}
+        assumptions = [rel(">", var("x"), num(0)), rel(">", var("y"), num(0))]
+        claim = rel(">", binary("+", var("x"), binary("+", var("y"), num(1))), num(0))
+        result = prove(assumptions, claim, ["x", "y"], premises=[premise])
+        assert result["ok"] is True
+
+    def test_step_callback(self):
+        # Each step result is reported as soon as it is checked
+        assumptions = [rel(">", var("x"), num(0))]
+        steps = [{"formula": rel(">", var("x"), num(-1))},
+                 {"formula": rel(">", var("x"), num(5))}]
+        seen = []
+        result = prove(assumptions, rel(">", var("x"), num(-2)), ["x"],
+                       steps=steps, on_step=seen.append)
+        assert result["ok"] is True
+        assert seen == result["step_results"]
+        assert [s["status"] for s in seen] == ["proven", "disproven"]
+
+    def test_timings(self):
+        # Every result reports microseconds per phase, with one solve
+        # time per top-level step
+        steps = [{"formula": rel(">", var("x"), num(-1))},
+                 {"formula": rel(">", var("x"), num(5))}]
+        result = prove([rel(">", var("x"), num(0))], rel(">", var("x"), num(-2)),
+                       ["x"], steps=steps)
+        timings = result["timings"]
+        for phase in ("decode", "validate", "theorems", "translate", "solve", "model"):
+            assert timings[phase] >= 0
+        assert len(timings["steps"]) == 2
+        assert sum(timings["steps"]) + timings["claim"] <= timings["solve"]
+
+    def test_stats(self):
+        # Solver statistics are attached per step and for the claim on request
+        steps = [{"formula": rel(">", var("x"), num(-1))}]
+        assumptions = [rel(">", var("x"), num(0))]
+        result = prove(assumptions, rel(">", var("x"), num(-2)), ["x"],
+                       steps=steps, stats=True)
+        assert "rlimit_count" in result["stats"]
+        assert "rlimit_count" in result["step_results"][0]["stats"]
+
+        result = prove(assumptions, rel(">", var("x"), num(-2)), ["x"], steps=steps)
+        assert "stats" not in result
+        assert "stats" not in result["step_results"][0]
+
+    def test_memory(self):
+        # Memory use is reported on request, in bytes
+        assumptions = [rel(">", var("x"), num(0))]
+        result = prove(assumptions, rel(">", var("x"), num(-2)), ["x"],
+                       memory=True)
+        memory = result["memory"]
+        assert memory["ast"] > 0
+        assert memory["z3_solve"] > 0
+        assert memory["process_peak_rss"] > 0
+        assert "memory" not in prove(assumptions, rel(">", var("x"), num(-2)), ["x"])
+
+    def test_model_options(self):
+        # x = sqrt(2) is a counterexample; y does not occur in the claim
+        assumptions = [rel("=", binary("*", var("x"), var("x")), num(2)),
+                       rel(">", var("x"), num(0))]
+        claim = rel("<", var("x"), num(1))
+        result = prove(assumptions, claim, ["x", "y"])
+        assert set(result["model"]) == {"x", "y"}
+
+        result = prove(assumptions, claim, ["x", "y"], model="relevant",
+                       model_format="decimal")
+        assert result["model"] == {"x": "1.4142135623?"}
+
+        result = prove(assumptions, claim, ["x", "y"], model="none")
+        assert result["status"] == "disproven"
+        assert "model" not in result and "message" not in result
+
+        assert prove(assumptions, claim, ["x"], model="some")["status"] == "error"
@@ -13,12 +13,148 @@ python_dir = os.path.join(project_root, "python")
 if python_dir not in sys.path:
     sys.path.insert(0, python_dir)
 
-from flask import Flask, request, jsonify, send_from_directory
+import json
+
+from flask import Flask, Response, request, jsonify, send_from_directory
 from parser import Lexer, Parser, ParseError
 from prover import prove
+from native import NativeProver, EngineError, default_binary
+from jobs import JobQueue, QueueFull
 
 app = Flask(__name__, static_folder='.')
 
+# Longest a client may block in /api/jobs/<id>/wait per request (seconds)
+MAX_WAIT = 60
+
+
+def run_python_prover(ast, on_step=None):
+    """Check a proof AST with the Python prover."""
+    return prove(
+        assumptions=ast.get('assumptions', []),
+        claim=ast.get('claim'),
+        declared_vars=ast.get('declared_vars', []),
+        var_types=ast.get('var_types', {}),
+        steps=ast.get('steps', []),
+        premises=ast.get('premises', []),
+        on_step=on_step
+    )
+
+
+def format_result(result):
+    """Shape a prover result for the playground."""
+    response = {
+        'ok': result.get('ok', False),
+        'status': result.get('status', 'unknown'),
+    }
+    
+    if result.get('ok'):
+        response['message'] = 'The claim follows logically from the assumptions.'
+    elif result.get('status') == 'disproven':
+        response['message'] = 'A counterexample was found.'
+        response['model'] = result.get('model', {})
+    elif result.get('status') == 'unknown':
+        response['message'] = result.get('message', 'Z3 could not determine satisfiability.')
+    elif result.get('status') == 'cancelled':
+        response['message'] = 'Superseded by a newer revision.'
+    else:
+        response['message'] = result.get('error', 'Unknown error')
+    
+    if result.get('step_results'):
+        response['step_results'] = result['step_results']
+    if result.get('timings'):
+        response['timings'] = result['timings']
+    
+    return response
+
+
+class Cancelled(Exception):
+    pass
+
+
+def make_checker():
+    """Checker for one worker: a persistent native prover when it has been
+    built, the Python prover otherwise. A cancelled native check is
+    interrupted inside Z3; a Python check stops at the next step. The job
+    queue runs all of a session's jobs on one worker, so passing the
+    session on lets its engine re-check edits incrementally."""
+    if os.path.exists(default_binary()):
+        engine = NativeProver()
+
+        def check_native(ast, on_step, cancel, session):
+            try:
+                return format_result(engine.check(ast, session=session,
+                                                  on_step=on_step, cancel=cancel))
+            except EngineError as e:
+                return format_result({'ok': False, 'status': 'error', 'error': str(e)})
+        return check_native
+
+    def check_python(ast, on_step, cancel, session):
+        def step(step_result):
+            if cancel.cancelled:
+                raise Cancelled()
+            on_step(step_result)
+        return format_result(run_python_prover(ast, step))
+    return check_python
+
+
+jobs = JobQueue(make_checker,
+                workers=int(os.environ.get('PLAYGROUND_WORKERS', os.cpu_count() or 2)))
+
+
+def parse_request():
+    """
+    Parse the proof in the request body.
+    
+    Returns (ast, None) on success, or (None, (body, status)) with an
+    error to send back.
+    """
+    data = request.get_json(silent=True)
+    if not data or 'code' not in data:
+        return None, ({
+            'ok': False,
+            'status': 'error',
+            'message': 'Missing "code" in request body'
+        }, 400)
+    
+    try:
+        lexer = Lexer(data['code'])
+        tokens = lexer.tokenize()
+        parser = Parser(tokens, base_path=os.path.join(project_root, 'examples'))
+        ast = parser.parse()
+    except ParseError as e:
+        return None, ({
+            'ok': False,
+            'status': 'error',
+            'message': f'Parse error: {str(e)}'
+        }, 200)
+    
+    if not ast.get('claim'):
+        return None, ({
+            'ok': False,
+            'status': 'error',
+            'message': 'No claim (prove statement) found in the proof'
+        }, 200)
+    
+    return ast, None
+
+
+def submit(ast):
+    """
+    Queue a parsed proof; returns (job_id, None) or (None, (body, status)).
+    
+    A request body with a "session" id (e.g. one editor tab) cancels that
+    session's earlier checks that have not finished.
+    """
+    data = request.get_json(silent=True) or {}
+    try:
+        return jobs.submit(ast, session=data.get('session')), None
+    except QueueFull:
+        return None, ({
+            'ok': False,
+            'status': 'error',
+            'message': 'The server is busy, try again shortly'
+        }, 503)
+
 
 @app.route('/')
 def index():
@@ -31,7 +167,8 @@ def check_proof():
     """
     Check a proof and return the result.
     
-    Request body: { "code": "assume x > 0\nprove x > 0" }
+    Request body: { "code": "assume x > 0\nprove x > 0",
+                    "session": "..." }  // optional, see submit()
     
     Response: {
         "ok": true/false,
@@ -40,82 +177,19 @@ def check_proof():
         "model": { "x": "1.5" },  // if disproven
         "step_results": [...]  // intermediate step results
     }
+    
+    The check runs on the worker pool like /api/jobs; this endpoint just
+    waits for it.
     """
     try:
-        data = request.get_json()
-        if not data or 'code' not in data:
-            return jsonify({
-                'ok': False,
-                'status': 'error',
-                'message': 'Missing "code" in request body'
-            }), 400
-        
-        code = data['code']
-        
-        # Parse the proof code
-        lexer = Lexer(code)
-        tokens = lexer.tokenize()
-        parser = Parser(tokens, base_path=os.path.join(project_root, 'examples'))
-        ast = parser.parse()
-        
-        # Check for parse errors
-        if ast.get('errors'):
-            return jsonify({
-                'ok': False,
-                'status': 'error',
-                'message': 'Parse errors:\n' + '\n'.join(ast['errors'])
-            })
-        
-        # Extract proof components from AST
-        assumptions = ast.get('assumptions', [])
-        claim = ast.get('claim')
-        declared_vars = ast.get('declared_vars', [])
-        var_types = ast.get('var_types', {})
-        steps = ast.get('steps', [])
-        
-        if not claim:
-            return jsonify({
-                'ok': False,
-                'status': 'error',
-                'message': 'No claim (prove statement) found in the proof'
-            })
-        
-        # Run the prover
-        result = prove(
-            assumptions=assumptions,
-            claim=claim,
-            declared_vars=declared_vars,
-            var_types=var_types,
-            steps=steps
-        )
-        
-        # Format the response
-        response = {
-            'ok': result.get('ok', False),
-            'status': result.get('status', 'unknown'),
-        }
-        
-        if result.get('ok'):
-            response['message'] = 'The claim follows logically from the assumptions.'
-        elif result.get('status') == 'disproven':
-            response['message'] = 'A counterexample was found.'
-            response['model'] = result.get('model', {})
-        elif result.get('status') == 'unknown':
-            response['message'] = result.get('message', 'Z3 could not determine satisfiability.')
-        else:
-            response['message'] = result.get('error', 'Unknown error')
-        
-        if result.get('step_results'):
-            response['step_results'] = result['step_results']
-        
-        return jsonify(response)
+        ast, error = parse_request()
+        if not error:
+            job_id, error = submit(ast)
+        if error:
+            body, status = error
+            return jsonify(body), status
+        return jsonify(jobs.wait(job_id)['result'])
     
-    except ParseError as e:
-        return jsonify({
-            'ok': False,
-            'status': 'error',
-            'message': f'Parse error: {str(e)}'
-        })
     except Exception as e:
         return jsonify({
             'ok': False,
@@ -124,6 +198,92 @@ def check_proof():
         }), 500
 
 
+@app.route('/api/check/stream', methods=['POST'])
+def check_proof_stream():
+    """
+    Check a proof, streaming results as NDJSON (one JSON object per line).
+    
+    Request body: { "code": "...", "session": "..." }  // session optional
+    
+    Response lines:
+        { "type": "step", "step_result": {...} }   // as each step finishes
+        { "type": "result", ... }                  // last; body as from /api/check
+    """
+    ast, error = parse_request()
+    if not error:
+        job_id, error = submit(ast)
+    if error:
+        body, status = error
+        line = json.dumps({'type': 'result', **body}) + '\n'
+        return Response(line, status=status, mimetype='application/x-ndjson')
+    
+    def generate():
+        seen = 0
+        while True:
+            update = jobs.events(job_id, seen, timeout=MAX_WAIT)
+            if update is None:
+                return
+            events, job = update
+            for step_result in events:
+                yield json.dumps({'type': 'step', 'step_result': step_result}) + '\n'
+            seen += len(events)
+            if job['state'] == 'done':
+                yield json.dumps({'type': 'result', **job['result']}) + '\n'
+                return
+    
+    return Response(generate(), mimetype='application/x-ndjson')
+
+
+@app.route('/api/jobs', methods=['POST'])
+def submit_job():
+    """
+    Queue a proof check without waiting for it.
+    
+    Request body: { "code": "...", "session": "..." }  // session optional
+    
+    Response (202): { "job_id": "...", "state": "queued" }
+    Parse errors are returned immediately, as from /api/check.
+    """
+    ast, error = parse_request()
+    if not error:
+        job_id, error = submit(ast)
+    if error:
+        body, status = error
+        return jsonify(body), status
+    return jsonify(jobs.get(job_id)), 202
+
+
+@app.route('/api/jobs/<job_id>', methods=['GET'])
+def get_job(job_id):
+    """
+    Poll a job.
+    
+    Response: { "job_id": "...", "state": "queued" | "running" | "done",
+                "result": {...} }  // result as from /api/check, once done
+    """
+    job = jobs.get(job_id)
+    if job is None:
+        return jsonify({'ok': False, 'status': 'error', 'message': 'Unknown job'}), 404
+    return jsonify(job)
+
+
+@app.route('/api/jobs/<job_id>/wait', methods=['GET'])
+def wait_job(job_id):
+    """
+    Wait for a job to finish, for at most ?timeout= seconds (default and
+    maximum 60). Returns the same body as polling; "state" is still
+    "queued" or "running" if the timeout expired first.
+    """
+    try:
+        timeout = min(float(request.args.get('timeout', MAX_WAIT)), MAX_WAIT)
+    except ValueError:
+        timeout = MAX_WAIT
+    job = jobs.wait(job_id, timeout=max(timeout, 0))
+    if job is None:
+        return jsonify({'ok': False, 'status': 'error', 'message': 'Unknown job'}), 404
+    return jsonify(job)
+
+
 @app.route('/api/examples', methods=['GET'])
 def get_examples():
     """Return a list of example proofs."""
@@ -187,4 +347,5 @@ if __name__ == '__main__':
     print("🧮 Proof Checker Playground")
     print("   Open http://localhost:5050 in your browser")
     print()
-    app.run(host='0.0.0.0', port=5050, debug=True)
+    # The reloader would start a second worker pool
+    app.run(host='0.0.0.0', port=5050, debug=True, use_reloader=False)